@@ -13,4 +13,8 @@
 -- wants to run LGI without installation, as Lua lacks './?/init.lua' in its
 -- package search path.
 
+-- The core is opened first, so that Lua modules embedded into it (when built
+-- with the 'embed-lua' option) are already registered in package.preload.
+require 'LuaGObject.lua_gobject_core'
+
 return require 'LuaGObject.init'
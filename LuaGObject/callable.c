@@ -11,7 +11,11 @@
 
 #include "lua_gobject.h"
 #include <string.h>
+#include <stdio.h>
 #include <ffi.h>
+#ifdef G_OS_UNIX
+#include <unistd.h>
+#endif
 
 /* Kinds or Param structure variation. */
 typedef enum _ParamKind {
@@ -26,6 +30,8 @@ typedef enum _ParamKind {
 } ParamKind;
 
 /* Represents single parameter in callable description. */
+typedef struct _ProfileEntry ProfileEntry;
+
 typedef struct _Param {
 	GITypeInfo *ti;
 	GIArgInfo ai;
@@ -69,6 +75,9 @@ typedef struct _Callable {
 	/* Optional, associated 'user_data' context field. */
 	gpointer user_data;
 
+	/* Lock of the state owning the callable. */
+	gpointer state_lock;
+
 	/* Flags with function characteristics. */
 	guint has_self : 1;
 	guint throws : 1;
@@ -76,9 +85,25 @@ typedef struct _Callable {
 	guint ignore_retval : 1;
 	guint is_closure_marshal : 1;
 
-	/* Initialized FFI CIF structure. */
+	/* Set by the user when the function can be called from multiple threads at once, see parallel_map. */
+	guint thread_safe : 1;
+
+	/* Set when the state lock does not have to be released during the call, because the function is short and never waits for other threads. */
+	guint nolock : 1;
+
+	/* Profiler entry of this callable, valid only in profiling run with the same generation. */
+	ProfileEntry *profile;
+	guint profile_generation;
+
+	/* FFI CIF structure.  Until the callable is prepared, it holds only the signature, see callable_prepare(). */
 	ffi_cif cif;
 
+	/* Set once the address is resolved and the cif is prepared. */
+	gint prepared;
+
+	/* Link of the callable in the queue of the background resolver, NULL when not queued. */
+	GList *pending;
+
 	/* Param return value and pointer to nargs Param instances. */
 	Param retval;
 	Param *params;
@@ -104,6 +129,8 @@ typedef struct _Callback {
 } Callback;
 
 typedef struct _FfiClosureBlock FfiClosureBlock;
+typedef struct _Deferred Deferred;
+typedef struct _AsyncReady AsyncReady;
 
 /* Single element in FFI callbacks block. */
 typedef struct _FfiClosure {
@@ -126,6 +153,13 @@ typedef struct _FfiClosure {
 		gpointer call_addr;
 	};
 
+	/* Deferred delivery target, if the closure was created for deferred callback, otherwise NULL. */
+	Deferred *deferred;
+
+	/* Profiler entry of this closure, see Callable. */
+	ProfileEntry *profile;
+	guint profile_generation;
+
 	/* Flag indicating whether closure should auto-destroy itself after it is called. */
 	guint autodestroy : 1;
 
@@ -144,13 +178,168 @@ struct _FfiClosureBlock {
 	/* Number of other closures in the block, excluding the forst one contained already in this header. */
 	int closures_count;
 
+	/* Async-ready trampoline which replaces this block once the arguments of the call are marshalled, and stack index of its userdata. */
+	AsyncReady *async_ready;
+	int async_ready_narg;
+
 	/* Variable-length array of pointers to other closures. Unfortunately libffi does not allow to allocate contiguous block containing more closures, otherwise this array would simply contain FfiClosure instances instead of pointers to dynamically allocated ones. */
 	FfiClosure *ffi_closures[1];
 };
 
+/* Metatable name of deferred callback userdata. */
+#define UD_DEFERRED "lua_gobject.deferred"
+
+/* How the argument of deferred callback is preserved until it is delivered. */
+typedef enum _DeferredCopy {
+	/* Internal argument, not passed to Lua. */
+	DEFERRED_COPY_NONE = 0,
+
+	/* Scalar value, copied directly. */
+	DEFERRED_COPY_VALUE,
+
+	/* String, duplicated. */
+	DEFERRED_COPY_STRING,
+
+	/* GObject, referenced. */
+	DEFERRED_COPY_OBJECT,
+
+	/* Boxed record, copied. */
+	DEFERRED_COPY_BOXED
+} DeferredCopy;
+
+/* Single queued invocation of deferred callback. */
+typedef struct _DeferredCall {
+	struct _DeferredCall *next;
+
+	/* Closure block to be destroyed after the call, if the closure was autodestroy one. */
+	FfiClosureBlock *destroy;
+
+	/* Copies of the arguments, as described by Deferred's copy array. */
+	GIArgument args[1];
+} DeferredCall;
+
+/* Lua callback whose invocations from threads other than the owner are queued and delivered from the owner's main context, instead of waiting for the state lock. */
+struct _Deferred {
+	/* Reference count; Lua userdata, the source, every closure bound to the callback and every queued call hold one. */
+	gint ref_count;
+
+	/* Thread which created the callback; calls from it are not deferred. */
+	GThread *owner;
+
+	/* Source draining the queue. */
+	GSource *source;
+
+	/* Thread used for delivering calls. */
+	Callback callback;
+
+	/* Lua target function. */
+	int target_ref;
+
+	/* Callable bound at the first closure creation and reference to it. */
+	Callable *callable;
+	int callable_ref;
+
+	/* Per-argument DeferredCopy, flags of transfer-full arguments, whose ownership is passed to the queued call instead of copying them, and GTypes of boxed arguments; NULL if bound callable cannot be deferred. */
+	guint8 *copy;
+	guint8 *owned;
+	GType *gtypes;
+	int nargs;
+
+	/* Guards the queue and the closed flag. */
+	GMutex mutex;
+
+	/* Set when the owning state tore the callback down, calls are dropped from then on. */
+	gboolean closed;
+
+	/* Stack of pending calls, newest first. */
+	DeferredCall *head;
+};
+
+typedef struct _DeferredSource {
+	GSource source;
+	Deferred *deferred;
+} DeferredSource;
+
+/* Persistent GAsyncReadyCallback trampoline, resuming the thread which started the asynchronous operation.  Unlike FfiClosureBlock, it is not destroyed after the callback fires, so that one instance can serve all operations started by the same coroutine. */
+struct _AsyncReady {
+	/* Thread to be resumed; thread_ref is held only while some operation is pending. */
+	Callback callback;
+
+	/* Lua reference to the userdata itself while some operation is pending. */
+	int self_ref;
+
+	/* Number of operations currently pending on this trampoline. */
+	guint pending;
+};
+
 /* lightuserdata key to callable cache table. */
 static int callable_cache;
 
+/* Accumulated times of single callable or closure, in nanoseconds.  For callables, phases are input marshalling, native call and output marshalling; for closures, argument marshalling, Lua code and return value marshalling. */
+struct _ProfileEntry {
+	gchar *name;
+	gboolean closure;
+	guint64 calls;
+	gint64 phases[3];
+};
+
+/* Sampled crossings sharing the same folded stack. */
+typedef struct _ProfileSample {
+	guint64 count;
+	gint64 time;
+} ProfileSample;
+
+/* Profiler of single Lua state, living in the registry at profile_key. */
+typedef struct _Profile {
+	gboolean running;
+	guint generation;
+
+	/* ProfileEntry instances, keyed by their names. */
+	GHashTable *entries;
+
+	/* When nonzero, every sample_every-th crossing is sampled with its Lua stack into samples, keyed by folded stack. */
+	guint sample_every, sample_countdown;
+	GHashTable *samples;
+} Profile;
+
+/* Maximum number of Lua frames recorded in a single sample. */
+#define PROFILE_SAMPLE_DEPTH 64
+
+static void
+profile_entry_free(gpointer data)
+{
+	ProfileEntry *entry = data;
+	g_free(entry->name);
+	g_free(entry);
+}
+
+static int profile_key;
+
+/* Number of states which are currently profiling, and source of unique profiling run generations. */
+static gint profile_active = 0;
+static gint profile_generation = 0;
+
+/* Set of all live closure blocks, for core.census(). */
+static GHashTable *closure_blocks = NULL;
+G_LOCK_DEFINE_STATIC(closure_blocks);
+
+/* Map file for perf, receiving names of closure trampolines when enabled by core.perfmap() or LUAGOBJECT_PERFMAP environment variable. */
+static FILE *perfmap = NULL;
+G_LOCK_DEFINE_STATIC(perfmap);
+
+/* Callables waiting for the background resolver, enabled by core.callable.eager() or LUAGOBJECT_EAGER_RESOLVE environment variable.  The mutex guards also resolving of any callable. */
+static GMutex pending_mutex;
+static GCond pending_cond;
+static GQueue pending_queue = G_QUEUE_INIT;
+static gint pending_eager = 0;
+static GThread *pending_thread = NULL;
+
+
+/* Namespaces whose functions are known not to wait for other threads; their simple getters do not release the state lock. */
+static const gchar *const leaf_namespaces[] = {
+	"cairo", "Gdk", "Graphene", "Gsk", "Gtk", "Pango", "PangoCairo", NULL
+};
+
 /* Gets ffi_type for given tag, returns NULL if it cannot be handled. */
 static ffi_type *
 get_simple_ffi_type(GITypeTag tag)
@@ -248,9 +437,10 @@ callable_allocate(lua_State *L, int nargs, ffi_type ***ffi_args)
 
 	/* Create userdata structure. */
 	luaL_checkstack(L, 2, NULL);
-	Callable *callable = lua_newuserdata(L, sizeof(Callable) +
-		sizeof(ffi_type) *(nargs + 2) +
-		sizeof(Param) * nargs);
+	gsize size = sizeof(Callable) + sizeof(ffi_type) *(nargs + 2) +
+		sizeof(Param) * nargs;
+	Callable *callable = lua_newuserdata(L, size);
+	lua_gobject_alloc_account(LUA_GOBJECT_ALLOC_CALLABLE, size);
 	memset(callable, 0, sizeof *callable);
 	lua_pushlightuserdata(L, &callable_mt);
 	lua_rawget(L, LUA_REGISTRYINDEX);
@@ -261,6 +451,7 @@ callable_allocate(lua_State *L, int nargs, ffi_type ***ffi_args)
 	callable->params =(Param *) &(*ffi_args)[nargs + 2];
 	callable->nargs = nargs;
 	callable->user_data = NULL;
+	callable->state_lock = lua_gobject_state_get_lock(L);
 	callable->info = NULL;
 	callable->has_self = 0;
 	callable->throws = 0;
@@ -294,6 +485,42 @@ callable_get_param(Callable *callable, gint n) {
 	return param;
 }
 
+/* Checks whether the call of the callable can keep the state lock locked. */
+static gboolean
+callable_is_leaf(Callable *callable)
+{
+	GIBaseInfo *info = GI_BASE_INFO(callable->info);
+	const gchar *name = gi_base_info_get_name(info);
+	const gchar *const *ns;
+	Param *param;
+	int i;
+
+	/* Only getters without callbacks and errors in leaf namespaces qualify. */
+	if (!GI_IS_FUNCTION_INFO(info) || callable->throws
+			|| !(g_str_has_prefix(name, "get_")
+				|| g_str_has_prefix(name, "is_")
+				|| g_str_has_prefix(name, "has_")))
+		return FALSE;
+	for (ns = leaf_namespaces; *ns != NULL; ns++)
+		if (strcmp(*ns, gi_base_info_get_namespace(info)) == 0)
+			break;
+	if (*ns == NULL)
+		return FALSE;
+
+	for (i = 0, param = callable->params; i < callable->nargs; i++, param++) {
+		gboolean callback = FALSE;
+		if (param->ti != NULL
+				&& gi_type_info_get_tag(param->ti) == GI_TYPE_TAG_INTERFACE) {
+			GIBaseInfo *ii = gi_type_info_get_interface(param->ti);
+			callback = GI_IS_CALLBACK_INFO(ii);
+			gi_base_info_unref(ii);
+		}
+		if (callback || param->n_closures > 0)
+			return FALSE;
+	}
+	return TRUE;
+}
+
 int
 lua_gobject_callable_create(lua_State *L, GICallableInfo *info, gpointer addr)
 {
@@ -310,22 +537,12 @@ lua_gobject_callable_create(lua_State *L, GICallableInfo *info, gpointer addr)
 	callable->address = addr;
 	if (GI_IS_FUNCTION_INFO(info)) {
 		/* Get FunctionInfo flags. */
-		const gchar* symbol;
 		gint flags = gi_function_info_get_flags(GI_FUNCTION_INFO(info));
 		if ((flags & GI_FUNCTION_IS_METHOD) != 0
 				&& (flags & GI_FUNCTION_IS_CONSTRUCTOR) == 0)
 			callable->has_self = 1;
 		if (gi_callable_info_can_throw_gerror(GI_CALLABLE_INFO(info)))
 			callable->throws = 1;
-
-		/* Resolve symbol(function address). */
-		symbol = gi_function_info_get_symbol(GI_FUNCTION_INFO(info));
-		if (!gi_typelib_symbol(
-				gi_base_info_get_typelib(GI_BASE_INFO(info)),
-					symbol, &callable->address))
-			/* Fail with the error message. */
-			return luaL_error(L, "could not locate %s(%s): %s",
-						lua_tostring(L, -3), symbol, g_module_error());
 	}
 	else if (GI_IS_SIGNAL_INFO(info))
 		/* Signals always have 'self', i.e. the object on which they are emitted. */
@@ -400,13 +617,21 @@ lua_gobject_callable_create(lua_State *L, GICallableInfo *info, gpointer addr)
 	if (callable->throws)
 		*ffi_arg++ = &ffi_type_pointer;
 
-	/* Create ffi_cif. */
-	if (ffi_prep_cif (&callable->cif, FFI_DEFAULT_ABI,
-			callable->has_self + nargs + callable->throws,
-			ffi_retval, ffi_args) != FFI_OK) {
-		lua_concat(L, lua_gobject_type_get_name(L,
-			GI_BASE_INFO(callable->info)));
-		return luaL_error(L, "ffi_prep_cif for `%s' failed", lua_tostring(L, -1));
+	callable->nolock = callable_is_leaf(callable);
+
+	/* Store the signature; the symbol is looked up and ffi_cif is prepared when the callable is used for the first time, or by the background resolver. */
+	callable->cif.abi = FFI_DEFAULT_ABI;
+	callable->cif.nargs = callable->has_self + nargs + callable->throws;
+	callable->cif.rtype = ffi_retval;
+	callable->cif.arg_types = ffi_args;
+	if (g_atomic_int_get(&pending_eager)) {
+		g_mutex_lock(&pending_mutex);
+		if (pending_eager) {
+			g_queue_push_tail(&pending_queue, callable);
+			callable->pending = pending_queue.tail;
+			g_cond_signal(&pending_cond);
+		}
+		g_mutex_unlock(&pending_mutex);
 	}
 
 	return 1;
@@ -557,12 +782,110 @@ lua_gobject_callable_parse(lua_State *L, int info, gpointer addr)
 	if (ffi_prep_cif (&callable->cif, FFI_DEFAULT_ABI,
 			nargs + callable->throws, ffi_retval, ffi_args) != FFI_OK)
 		return luaL_error(L, "ffi_prep_cif failed for parsed");
+	callable->prepared = 1;
 
 	/* Attach env table to the returned callable instance. */
 	lua_setfenv(L, -2);
 	return 1;
 }
 
+/* Resolves function address and prepares the cif of the callable.  Must be called with pending_mutex held.  Returns error message on failure, which must be freed. */
+static gchar *
+callable_resolve(Callable *callable)
+{
+	if (GI_IS_FUNCTION_INFO(callable->info)) {
+		const gchar *symbol = gi_function_info_get_symbol(
+			GI_FUNCTION_INFO(callable->info));
+		if (!lua_gobject_gi_typelib_symbol(
+				gi_base_info_get_typelib(GI_BASE_INFO(callable->info)),
+				symbol, &callable->address))
+			return g_strdup_printf("could not locate %s: %s", symbol,
+				g_module_error());
+	}
+
+	if (ffi_prep_cif(&callable->cif, callable->cif.abi, callable->cif.nargs,
+			callable->cif.rtype, callable->cif.arg_types) != FFI_OK)
+		return g_strdup("ffi_prep_cif failed");
+
+	g_atomic_int_set(&callable->prepared, 1);
+	return NULL;
+}
+
+/* Removes the callable from the queue of the background resolver.  Must be called with pending_mutex held. */
+static void
+callable_unqueue(Callable *callable)
+{
+	if (callable->pending != NULL) {
+		g_queue_delete_link(&pending_queue, callable->pending);
+		callable->pending = NULL;
+	}
+}
+
+/* Makes sure that the callable can be called, throws Lua error when its symbol cannot be resolved. */
+static void
+callable_prepare(lua_State *L, Callable *callable)
+{
+	gchar *error = NULL;
+	if (G_LIKELY(g_atomic_int_get(&callable->prepared)))
+		return;
+
+	g_mutex_lock(&pending_mutex);
+	if (!callable->prepared)
+		error = callable_resolve(callable);
+	callable_unqueue(callable);
+	g_mutex_unlock(&pending_mutex);
+	if (error != NULL) {
+		luaL_checkstack(L, 4, "");
+		lua_concat(L, lua_gobject_type_get_name(L,
+			GI_BASE_INFO(callable->info)));
+		lua_pushfstring(L, "%s: %s", lua_tostring(L, -1), error);
+		g_free(error);
+		lua_error(L);
+	}
+}
+
+/* Background resolver thread, prepares queued callables one by one, so that callers waiting in callable_prepare() get their turn in between. */
+static gpointer
+pending_run(gpointer data)
+{
+	g_mutex_lock(&pending_mutex);
+	for (;;) {
+		Callable *callable;
+		while (g_queue_is_empty(&pending_queue))
+			g_cond_wait(&pending_cond, &pending_mutex);
+
+		callable = g_queue_pop_head(&pending_queue);
+		callable->pending = NULL;
+		if (!callable->prepared)
+			/* Failures are reported by the first call. */
+			g_free(callable_resolve(callable));
+
+		g_mutex_unlock(&pending_mutex);
+		g_thread_yield();
+		g_mutex_lock(&pending_mutex);
+	}
+	return NULL;
+}
+
+/* Turns the background resolver on or off, returns previous state. */
+static gboolean
+pending_enable(gboolean enable)
+{
+	gboolean previous;
+	g_mutex_lock(&pending_mutex);
+	previous = pending_eager;
+	g_atomic_int_set(&pending_eager, enable);
+	if (enable && pending_thread == NULL)
+		pending_thread = g_thread_new("lua_gobject-resolver", pending_run, NULL);
+	if (!enable)
+		while (!g_queue_is_empty(&pending_queue)) {
+			Callable *callable = g_queue_pop_head(&pending_queue);
+			callable->pending = NULL;
+		}
+	g_mutex_unlock(&pending_mutex);
+	return previous;
+}
+
 /* Checks whether given argument is Callable userdata. */
 static Callable *
 callable_get(lua_State *L, int narg)
@@ -597,6 +920,14 @@ callable_gc(lua_State *L)
 
 	/* Unref embedded 'info' field. */
 	Callable *callable = callable_get(L, 1);
+	lua_gobject_alloc_account(LUA_GOBJECT_ALLOC_CALLABLE,
+		-(gssize) lua_objlen(L, 1));
+	if (!g_atomic_int_get(&callable->prepared)) {
+		/* Do not leave the callable in the queue of the background resolver. */
+		g_mutex_lock(&pending_mutex);
+		callable_unqueue(callable);
+		g_mutex_unlock(&pending_mutex);
+	}
 	if (callable->info)
 	gi_base_info_unref(callable->info);
 
@@ -618,7 +949,8 @@ callable_describe(lua_State *L, Callable *callable, FfiClosure *closure)
 	luaL_checkstack(L, 2, "");
 
 	if (closure == NULL)
-		lua_pushfstring(L, "%p", callable->address);
+		lua_pushfstring(L, "%p", g_atomic_int_get(&callable->prepared)
+			? callable->address : NULL);
 	else {
 		gconstpointer ptr;
 		lua_rawgeti(L, LUA_REGISTRYINDEX, closure->target_ref);
@@ -651,6 +983,129 @@ callable_describe(lua_State *L, Callable *callable, FfiClosure *closure)
 	lua_replace(L, -2);
 }
 
+#ifdef LUA_GOBJECT_USDT
+/* Name reported by static tracepoints, the C symbol when available. */
+static const gchar *
+callable_probe_name(Callable *callable)
+{
+	if (callable->info == NULL)
+		return "";
+	if (GI_IS_FUNCTION_INFO(callable->info))
+		return gi_function_info_get_symbol(
+			GI_FUNCTION_INFO(callable->info));
+	return gi_base_info_get_name(GI_BASE_INFO(callable->info));
+}
+#endif
+
+/* Appends one frame to the folded stack, with separators replaced. */
+static void
+profile_sample_frame(GString *stack, const char *frame)
+{
+	if (stack->len > 0)
+		g_string_append_c(stack, ';');
+	for (; *frame != '\0'; frame++)
+		g_string_append_c(stack, *frame == ';' ? ':' : *frame);
+}
+
+/* Records the Lua stack of a crossing into the samples of the profiler.  The stack is folded as 'outermost;...;innermost;crossing', the form expected by flamegraph.pl. */
+static void
+profile_sample(lua_State *L, Profile *profile, Callable *callable,
+	FfiClosure *closure, gint64 time)
+{
+	lua_Debug ar[PROFILE_SAMPLE_DEPTH];
+	ProfileSample *sample;
+	GString *stack;
+	int level, depth = 0;
+
+	/* Collect frames of the Lua stack, innermost first.  The innermost frame of a call is callable_call itself, represented by the crossing. */
+	for (level = closure == NULL ? 1 : 0; depth < PROFILE_SAMPLE_DEPTH
+			&& lua_getstack(L, level, &ar[depth]); level++)
+		if (lua_getinfo(L, "Sn", &ar[depth])
+				&& (*ar[depth].what != 'C' || ar[depth].name != NULL))
+			depth++;
+
+	luaL_checkstack(L, 6, "");
+	stack = g_string_new(NULL);
+	while (depth-- > 0) {
+		lua_Debug *frame = &ar[depth];
+		if (*frame->what == 'm')
+			lua_pushstring(L, frame->short_src);
+		else
+			lua_pushfstring(L, "%s@%s:%d", frame->name ? frame->name : "?",
+				frame->short_src, frame->linedefined);
+		profile_sample_frame(stack, lua_tostring(L, -1));
+		lua_pop(L, 1);
+	}
+	if (callable->info != NULL) {
+		lua_concat(L, lua_gobject_type_get_name(L,
+			GI_BASE_INFO(callable->info)));
+		profile_sample_frame(stack, lua_tostring(L, -1));
+		lua_pop(L, 1);
+	} else
+		profile_sample_frame(stack, "lua_gobject.efn");
+	if (closure != NULL)
+		profile_sample_frame(stack, "callback");
+
+	sample = g_hash_table_lookup(profile->samples, stack->str);
+	if (sample == NULL) {
+		sample = g_new0(ProfileSample, 1);
+		g_hash_table_insert(profile->samples, g_string_free(stack, FALSE),
+			sample);
+	} else
+		g_string_free(stack, TRUE);
+	sample->count++;
+	sample->time += time;
+}
+
+/* Adds times of one call into the profiler.  Stamps contain start of the call and ends of its first two phases; the third phase ends now.  Callable must be at stack index 1 unless it has info. */
+static void
+profile_record(lua_State *L, Callable *callable, FfiClosure *closure,
+	const gint64 *stamps)
+{
+	ProfileEntry **cached = closure ? &closure->profile : &callable->profile;
+	guint *generation = closure ? &closure->profile_generation
+		: &callable->profile_generation;
+	gint64 now = lua_gobject_clock_ns();
+	ProfileEntry *entry;
+	Profile *profile;
+
+	lua_pushlightuserdata(L, &profile_key);
+	lua_rawget(L, LUA_REGISTRYINDEX);
+	profile = lua_touserdata(L, -1);
+	lua_pop(L, 1);
+	if (profile == NULL || !profile->running)
+		return;
+
+	/* Find the entry by description, first time in this profiling run. */
+	if (*generation != profile->generation) {
+		if (closure == NULL || callable->info != NULL)
+			callable_describe(L, callable, closure);
+		else
+			lua_pushliteral(L, "lua_gobject.cbk");
+		entry = g_hash_table_lookup(profile->entries, lua_tostring(L, -1));
+		if (entry == NULL) {
+			entry = g_new0(ProfileEntry, 1);
+			entry->name = g_strdup(lua_tostring(L, -1));
+			entry->closure = closure != NULL;
+			g_hash_table_insert(profile->entries, entry->name, entry);
+		}
+		lua_pop(L, 1);
+		*cached = entry;
+		*generation = profile->generation;
+	}
+
+	entry = *cached;
+	entry->calls++;
+	entry->phases[0] += stamps[1] - stamps[0];
+	entry->phases[1] += stamps[2] - stamps[1];
+	entry->phases[2] += now - stamps[2];
+
+	if (profile->sample_every != 0 && --profile->sample_countdown == 0) {
+		profile->sample_countdown = profile->sample_every;
+		profile_sample(L, profile, callable, closure, now - stamps[0]);
+	}
+}
+
 static int
 callable_tostring(lua_State *L)
 {
@@ -742,6 +1197,25 @@ callable_param_2lua(lua_State *L, Param *param, GIArgument *arg,
 	}
 }
 
+/* Binds async-ready trampoline recorded in the closure block at *user_data to the current thread, and replaces the block with it. */
+static void
+async_ready_commit(lua_State *L, gpointer *user_data)
+{
+	FfiClosureBlock *block = *user_data;
+	AsyncReady *ready = block->async_ready;
+	if (ready->pending++ == 0) {
+		/* Remember current thread and keep both it and the trampoline alive until the operation finishes. */
+		lua_pushthread(L);
+		ready->callback.thread_ref = luaL_ref(L, LUA_REGISTRYINDEX);
+		ready->callback.L = L;
+		ready->callback.state_lock = lua_gobject_state_get_lock(L);
+		lua_pushvalue(L, block->async_ready_narg);
+		ready->self_ref = luaL_ref(L, LUA_REGISTRYINDEX);
+	}
+	lua_gobject_closure_destroy(block);
+	*user_data = ready;
+}
+
 static int
 callable_call(lua_State *L)
 {
@@ -750,8 +1224,18 @@ callable_call(lua_State *L)
 	GIArgument retval, *args;
 	void **ffi_args, **redirect_out;
 	GError *err = NULL;
-	gpointer state_lock = lua_gobject_state_get_lock(L);
+	gboolean unlocked = FALSE;
+	gint64 hold_start = 0;
 	Callable *callable = callable_get(L, 1);
+	gboolean profiling = g_atomic_int_get(&profile_active) > 0;
+	gint64 stamps[3];
+	LUA_GOBJECT_PROBE_START(call__return, probe_start);
+
+	callable_prepare(L, callable);
+	if (profiling)
+		stamps[0] = lua_gobject_clock_ns();
+	LUA_GOBJECT_PROBE2(call__entry, callable_probe_name(callable),
+		callable->address);
 
 	/* Make sure that all unspecified arguments are set as nil; during marshalling we might create temporary values on the stack, which can be confused with input arguments expected but not passed by caller. */
 	lua_settop(L, callable->has_self + callable->nargs + 1);
@@ -839,20 +1323,44 @@ callable_call(lua_State *L)
 			/* Provide userdata for the callback. */
 			args[i + callable->has_self].v_pointer = callable->user_data;
 
+	/* Async-ready trampolines are bound only when all arguments are marshalled, so that a marshalling error does not leave them pending forever. */
+	param = &callable->params[0];
+	for (i = 0; i < callable->nargs; i++, param++)
+		if (param->n_closures > 0 && !param->internal_user_data) {
+			FfiClosureBlock *block = args[i + callable->has_self].v_pointer;
+			if (block->async_ready != NULL)
+				async_ready_commit(L,
+					&args[i + callable->has_self].v_pointer);
+		}
+
 	/* Add error for 'throws' type function. */
 	if (callable->throws) {
 		redirect_out[nargs] = &err;
 		ffi_args[nargs] = &redirect_out[nargs];
 	}
 
-	/* Unlock the state. */
-	lua_gobject_state_leave(state_lock);
+	if (profiling)
+		stamps[1] = lua_gobject_clock_ns();
+
+	/* Unlock the state, unless the call is known to be short or the state is single-threaded.  Calls which keep the lock are the ones holding it, so they are accounted in lock statistics. */
+	if (!callable->nolock
+			&& !lua_gobject_state_get_single_threaded(callable->state_lock)) {
+		lua_gobject_state_leave(callable->state_lock);
+		unlocked = TRUE;
+	} else
+		hold_start = lua_gobject_state_hold_start(callable->state_lock);
 
 	/* Call the function. */
 	ffi_call(&callable->cif, callable->address, &retval, ffi_args);
 
 	/* Heading back to Lua, lock the state back again. */
-	lua_gobject_state_enter(state_lock);
+	if (unlocked)
+		lua_gobject_state_enter(callable->state_lock);
+	else if (hold_start != 0)
+		lua_gobject_state_held(callable->state_lock,
+			GI_BASE_INFO(callable->info), hold_start);
+	if (profiling)
+		stamps[2] = lua_gobject_clock_ns();
 
 	/* Pop any temporary items from the stack which might be stored there by marshalling code. */
 	lua_pop(L, nret);
@@ -887,6 +1395,10 @@ callable_call(lua_State *L)
 		/* Wrap error instance into GLib.Error record. */
 		lua_gobject_type_get_repotype(L, G_TYPE_ERROR, NULL);
 		lua_gobject_record_2lua(L, err, TRUE, 0);
+		if (profiling)
+			profile_record(L, callable, NULL, stamps);
+		LUA_GOBJECT_PROBE2(call__return, callable_probe_name(callable),
+			LUA_GOBJECT_PROBE_ELAPSED(probe_start));
 		return nret + 1;
 	}
 
@@ -923,6 +1435,10 @@ callable_call(lua_State *L)
 	}
 
 	g_assert(caller_allocated == 0);
+	if (profiling)
+		profile_record(L, callable, NULL, stamps);
+	LUA_GOBJECT_PROBE2(call__return, callable_probe_name(callable),
+		LUA_GOBJECT_PROBE_ELAPSED(probe_start));
 	return nret;
 }
 
@@ -976,6 +1492,12 @@ callable_index(lua_State *L)
 	} else if (g_strcmp0(verb, "user_data") == 0) {
 		lua_pushlightuserdata(L, callable->user_data);
 		return 1;
+	} else if (g_strcmp0(verb, "thread_safe") == 0) {
+		lua_pushboolean(L, callable->thread_safe);
+		return 1;
+	} else if (g_strcmp0(verb, "nolock") == 0) {
+		lua_pushboolean(L, callable->nolock);
+		return 1;
 	}
 
 	return 0;
@@ -985,8 +1507,13 @@ static int
 callable_newindex(lua_State *L)
 {
 	Callable *callable = callable_get(L, 1);
-	if (g_strcmp0(lua_tostring(L, 2), "user_data") == 0)
+	const gchar *verb = lua_tostring(L, 2);
+	if (g_strcmp0(verb, "user_data") == 0)
 		callable->user_data = lua_touserdata(L, 3);
+	else if (g_strcmp0(verb, "thread_safe") == 0)
+		callable->thread_safe = lua_toboolean(L, 3);
+	else if (g_strcmp0(verb, "nolock") == 0)
+		callable->nolock = lua_toboolean(L, 3);
 
 	return 0;
 }
@@ -1137,6 +1664,126 @@ marshal_return_error(lua_State *L, void *ret, void **args, Callable *callable)
 		*(gboolean *) ret = FALSE;
 }
 
+/* Drops reference to deferred callback, frees it when unused.  Does not touch Lua state, Lua references are released when the callback is torn down. */
+static void
+deferred_unref(Deferred *deferred)
+{
+	if (g_atomic_int_dec_and_test(&deferred->ref_count)) {
+		g_mutex_clear(&deferred->mutex);
+		g_free(deferred->copy);
+		g_free(deferred->owned);
+		g_free(deferred->gtypes);
+		g_free(deferred);
+	}
+}
+
+/* Releases argument owned by queued call. */
+static void
+deferred_arg_free(Deferred *deferred, int i, GIArgument *arg)
+{
+	if (arg->v_pointer == NULL)
+		return;
+	switch (deferred->copy[i]) {
+	case DEFERRED_COPY_STRING:
+		g_free(arg->v_pointer);
+		break;
+	case DEFERRED_COPY_OBJECT:
+		g_object_unref(arg->v_pointer);
+		break;
+	case DEFERRED_COPY_BOXED:
+		g_boxed_free(deferred->gtypes[i], arg->v_pointer);
+		break;
+	default:
+		break;
+	}
+}
+
+/* Frees queued call which is not going to be delivered, together with its arguments.  Must be called with state lock held, because it destroys autodestroy closure. */
+static void
+deferred_call_free(Deferred *deferred, DeferredCall *call)
+{
+	int i;
+	for (i = 0; i < deferred->nargs; i++)
+		deferred_arg_free(deferred, i, &call->args[i]);
+	if (call->destroy != NULL)
+		lua_gobject_closure_destroy(call->destroy);
+	g_free(call);
+	deferred_unref(deferred);
+}
+
+/* Queues invocation of deferred closure instead of calling it, when invoked from foreign thread.  Must not touch Lua state at all.  Returns FALSE if the invocation has to be performed synchronously. */
+static gboolean
+closure_defer(FfiClosure *closure, void **args)
+{
+	Deferred *deferred = closure->deferred;
+	Callable *callable;
+	DeferredCall *call;
+	int i;
+
+	if (deferred->copy == NULL || g_thread_self() == deferred->owner)
+		return FALSE;
+
+	/* Check objects first, so that nothing has to be undone. */
+	for (i = 0; i < deferred->nargs; i++)
+		if (deferred->copy[i] == DEFERRED_COPY_OBJECT) {
+			gpointer object =((GIArgument *) args[i])->v_pointer;
+			if (object != NULL && !G_IS_OBJECT(object))
+				return FALSE;
+		}
+
+	g_mutex_lock(&deferred->mutex);
+	if (deferred->closed) {
+		/* The state is gone; drop the call, releasing arguments passed to us. */
+		g_mutex_unlock(&deferred->mutex);
+		for (i = 0; i < deferred->nargs; i++)
+			if (deferred->owned[i])
+				deferred_arg_free(deferred, i, args[i]);
+		return TRUE;
+	}
+
+	/* Callable is alive until the callback is torn down, which cannot happen while we hold the mutex. */
+	callable = deferred->callable;
+	call = g_malloc0(G_STRUCT_OFFSET(DeferredCall, args)
+		+ MAX(callable->nargs, 1) * sizeof(GIArgument));
+	for (i = 0; i < callable->nargs; i++) {
+		GIArgument *arg = args[i];
+		if (deferred->copy[i] == DEFERRED_COPY_VALUE) {
+			memcpy(&call->args[i], arg, callable->cif.arg_types[i]->size);
+			continue;
+		}
+
+		/* Transfer-full arguments are already ours, others are copied. */
+		if (deferred->owned[i] || arg->v_pointer == NULL) {
+			call->args[i].v_pointer = arg->v_pointer;
+			continue;
+		}
+		switch (deferred->copy[i]) {
+		case DEFERRED_COPY_STRING:
+			call->args[i].v_pointer = g_strdup(arg->v_pointer);
+			break;
+		case DEFERRED_COPY_OBJECT:
+			call->args[i].v_pointer = g_object_ref(arg->v_pointer);
+			break;
+		case DEFERRED_COPY_BOXED:
+			call->args[i].v_pointer =
+				g_boxed_copy(deferred->gtypes[i], arg->v_pointer);
+			break;
+		default:
+			break;
+		}
+	}
+	if (closure->autodestroy)
+		call->destroy = closure->block;
+
+	/* Push the call and wake up the owner. */
+	g_atomic_int_inc(&deferred->ref_count);
+	call->next = deferred->head;
+	deferred->head = call;
+	g_source_set_ready_time(deferred->source, 0);
+	g_mutex_unlock(&deferred->mutex);
+	return TRUE;
+}
+
 /* Closure callback, called by libffi when C code wants to invoke Lua
 	callback. */
 static void
@@ -1150,10 +1797,20 @@ closure_callback(ffi_cif *cif, void *ret, void **args, void *closure_arg)
 	gboolean call;
 	lua_State *L;
 	lua_State *marshal_L;
+	gboolean profiling;
+	gint64 stamps[3];
+	LUA_GOBJECT_PROBE_START(closure__return, probe_start);
 	(void)cif;
 
+	/* Deferred closure invoked from foreign thread is only queued. */
+	if (closure->deferred != NULL && closure_defer(closure, args))
+		return;
+
 	/* Get access to proper Lua context. */
 	lua_gobject_state_enter(block->callback.state_lock);
+	profiling = g_atomic_int_get(&profile_active) > 0;
+	if (profiling)
+		stamps[0] = lua_gobject_clock_ns();
 	lua_rawgeti(block->callback.L,
 		LUA_REGISTRYINDEX, block->callback.thread_ref);
 	L = lua_tothread(block->callback.L, -1);
@@ -1202,6 +1859,10 @@ closure_callback(ffi_cif *cif, void *ret, void **args, void *closure_arg)
 	lua_rawgeti(marshal_L, LUA_REGISTRYINDEX, closure->callable_ref);
 	callable = lua_touserdata(marshal_L, -1);
 	callable_index = lua_gettop(marshal_L);
+	lua_gobject_state_mark(block->callback.state_lock,
+		GI_BASE_INFO(callable->info), TRUE);
+	LUA_GOBJECT_PROBE2(closure__entry, callable_probe_name(callable),
+		closure);
 
 	npos = marshal_arguments(marshal_L, args, callable_index, callable);
 
@@ -1212,6 +1873,8 @@ closure_callback(ffi_cif *cif, void *ret, void **args, void *closure_arg)
 	lua_xmove(marshal_L, L, npos + extra_args);
 	if (L != marshal_L)
 		g_assert(lua_gettop(marshal_L) == 0);
+	if (profiling)
+		stamps[1] = lua_gobject_clock_ns();
 	if (call) {
 		if (callable->throws)
 			res = lua_pcall(L, npos, LUA_MULTRET, 0);
@@ -1246,6 +1909,8 @@ closure_callback(ffi_cif *cif, void *ret, void **args, void *closure_arg)
 			stacktop = lua_gettop(L);
 	}
 
+	if (profiling)
+		stamps[2] = lua_gobject_clock_ns();
 	lua_xmove(L, marshal_L, lua_gettop(L) - stacktop);
 
 	/* Reintroduce callable to the stack, we might need it during marshalling of the response. Put it right before all returns. */
@@ -1264,6 +1929,11 @@ closure_callback(ffi_cif *cif, void *ret, void **args, void *closure_arg)
 	if (closure->autodestroy)
 		*lua_gobject_guard_create(L, lua_gobject_closure_destroy) = block;
 
+	if (profiling)
+		profile_record(L, callable, closure, stamps);
+	LUA_GOBJECT_PROBE2(closure__return, callable_probe_name(callable),
+		LUA_GOBJECT_PROBE_ELAPSED(probe_start));
+
 	/* This is NOT called by Lua, so we better leave the Lua stack we used pretty much tidied. */
 	lua_settop(L, stacktop);
 	if (L != marshal_L)
@@ -1273,6 +1943,14 @@ closure_callback(ffi_cif *cif, void *ret, void **args, void *closure_arg)
 	lua_gobject_state_leave(block->callback.state_lock);
 }
 
+/* Bytes occupied by closure block with given number of additional closures. */
+static gsize
+closure_block_size(int count)
+{
+	return offsetof(FfiClosureBlock, ffi_closures)
+		+ count * (sizeof(FfiClosure *) + sizeof(FfiClosure));
+}
+
 /* Destroys specified closure. */
 void
 lua_gobject_closure_destroy(gpointer user_data)
@@ -1282,11 +1960,18 @@ lua_gobject_closure_destroy(gpointer user_data)
 	FfiClosure *closure;
 	int i;
 
+	lua_gobject_alloc_account(LUA_GOBJECT_ALLOC_CLOSURE,
+		-(gssize) closure_block_size(block->closures_count));
+	G_LOCK(closure_blocks);
+	g_hash_table_remove(closure_blocks, block);
+	G_UNLOCK(closure_blocks);
 	for (i = block->closures_count - 1; i >= -1; --i) {
 		closure =(i < 0) ? &block->ffi_closure : block->ffi_closures[i];
 		if (closure->created) {
 			luaL_unref(L, LUA_REGISTRYINDEX, closure->callable_ref);
 			luaL_unref(L, LUA_REGISTRYINDEX, closure->target_ref);
+			if (closure->deferred != NULL)
+				deferred_unref(closure->deferred);
 		}
 		if (i < 0)
 			luaL_unref(L, LUA_REGISTRYINDEX, block->callback.thread_ref);
@@ -1294,6 +1979,52 @@ lua_gobject_closure_destroy(gpointer user_data)
 	}
 }
 
+void
+lua_gobject_closure_census(lua_State *L, int census)
+{
+	gpointer state_lock = lua_gobject_state_get_lock(L);
+	GPtrArray *blocks = g_ptr_array_new();
+	GHashTableIter iter;
+	gpointer key;
+	guint b;
+
+	/* Pick blocks of this state; these cannot be destroyed while we hold its lock, blocks of other states cannot be inspected. */
+	G_LOCK(closure_blocks);
+	if (closure_blocks != NULL) {
+		g_hash_table_iter_init(&iter, closure_blocks);
+		while (g_hash_table_iter_next(&iter, &key, NULL))
+			if (((FfiClosureBlock *) key)->callback.state_lock == state_lock)
+				g_ptr_array_add(blocks, key);
+	}
+	G_UNLOCK(closure_blocks);
+
+	for (b = 0; b < blocks->len; b++) {
+		FfiClosureBlock *block = g_ptr_array_index(blocks, b);
+		Callable *callable = NULL;
+		int i;
+
+		/* Name the block after the first closure which was created. */
+		for (i = -1; i < block->closures_count && callable == NULL; i++) {
+			FfiClosure *closure = (i < 0) ? &block->ffi_closure
+				: block->ffi_closures[i];
+			if (closure->created) {
+				lua_rawgeti(L, LUA_REGISTRYINDEX, closure->callable_ref);
+				callable = lua_touserdata(L, -1);
+				lua_pop(L, 1);
+			}
+		}
+		if (callable != NULL && callable->info != NULL)
+			lua_concat(L, lua_gobject_type_get_name(L,
+				GI_BASE_INFO(callable->info)));
+		else
+			lua_pushliteral(L, "callback");
+		lua_gobject_census_add(L, census, lua_tostring(L, -1),
+			closure_block_size(block->closures_count));
+		lua_pop(L, 1);
+	}
+	g_ptr_array_free(blocks, TRUE);
+}
+
 /* Creates container block for allocated closures.  Returns address of the block, suitable as user_data parameter. */
 gpointer
 lua_gobject_closure_allocate(lua_State *L, int count)
@@ -1309,6 +2040,7 @@ lua_gobject_closure_allocate(lua_State *L, int count)
 	block->ffi_closure.call_addr = call_addr;
 	block->ffi_closure.block = block;
 	block->closures_count = count;
+	block->async_ready = NULL;
 
 	/* Allocate all additional closures. */
 	for (i = 0; i < count; ++i) {
@@ -1325,9 +2057,319 @@ lua_gobject_closure_allocate(lua_State *L, int count)
 
 	/* Retrieve and remember state lock. */
 	block->callback.state_lock = lua_gobject_state_get_lock(L);
+	lua_gobject_alloc_account(LUA_GOBJECT_ALLOC_CLOSURE,
+		closure_block_size(count));
+	G_LOCK(closure_blocks);
+	if (closure_blocks == NULL)
+		closure_blocks = g_hash_table_new(NULL, NULL);
+	g_hash_table_add(closure_blocks, block);
+	G_UNLOCK(closure_blocks);
 	return block;
 }
 
+/* Analyzes callable bound to deferred callback, fills in copy descriptions if it can be deferred. */
+static void
+deferred_analyze(Deferred *deferred, Callable *callable)
+{
+	guint8 *copy, *owned;
+	GType *gtypes;
+	int i;
+
+	if (callable->info == NULL || callable->has_self || callable->throws
+		|| callable->is_closure_marshal
+		|| gi_type_info_get_tag(callable->retval.ti) != GI_TYPE_TAG_VOID
+		|| gi_type_info_is_pointer(callable->retval.ti))
+		return;
+
+	copy = g_new0(guint8, MAX(callable->nargs, 1));
+	owned = g_new0(guint8, MAX(callable->nargs, 1));
+	gtypes = g_new0(GType, MAX(callable->nargs, 1));
+	for (i = 0; i < callable->nargs; i++) {
+		Param *param = &callable->params[i];
+		GITypeTag tag;
+		if (param->internal)
+			continue;
+		if (param->kind != PARAM_KIND_TI || param->ti == NULL
+			|| param->dir != GI_DIRECTION_IN)
+			goto fail;
+
+		tag = gi_type_info_get_tag(param->ti);
+		switch (tag) {
+		case GI_TYPE_TAG_BOOLEAN:
+		case GI_TYPE_TAG_INT8:
+		case GI_TYPE_TAG_UINT8:
+		case GI_TYPE_TAG_INT16:
+		case GI_TYPE_TAG_UINT16:
+		case GI_TYPE_TAG_INT32:
+		case GI_TYPE_TAG_UINT32:
+		case GI_TYPE_TAG_INT64:
+		case GI_TYPE_TAG_UINT64:
+		case GI_TYPE_TAG_FLOAT:
+		case GI_TYPE_TAG_DOUBLE:
+		case GI_TYPE_TAG_GTYPE:
+		case GI_TYPE_TAG_UNICHAR:
+			if (gi_type_info_is_pointer(param->ti))
+				goto fail;
+			copy[i] = DEFERRED_COPY_VALUE;
+			break;
+
+		case GI_TYPE_TAG_UTF8:
+		case GI_TYPE_TAG_FILENAME:
+			copy[i] = DEFERRED_COPY_STRING;
+			break;
+
+		case GI_TYPE_TAG_INTERFACE:
+		{
+			GIBaseInfo *info = gi_type_info_get_interface(param->ti);
+			if (GI_IS_ENUM_INFO(info))
+				copy[i] = DEFERRED_COPY_VALUE;
+			else if (GI_IS_OBJECT_INFO(info) || GI_IS_INTERFACE_INFO(info))
+				copy[i] = DEFERRED_COPY_OBJECT;
+			else if ((GI_IS_STRUCT_INFO(info) || GI_IS_UNION_INFO(info))
+				&& gi_type_info_is_pointer(param->ti)) {
+				gtypes[i] = gi_registered_type_info_get_g_type(
+					GI_REGISTERED_TYPE_INFO(info));
+				if (G_TYPE_IS_BOXED(gtypes[i]))
+					copy[i] = DEFERRED_COPY_BOXED;
+			}
+			gi_base_info_unref(info);
+			if (copy[i] == DEFERRED_COPY_NONE)
+				goto fail;
+			break;
+		}
+
+		default:
+			goto fail;
+		}
+		owned[i] = copy[i] != DEFERRED_COPY_VALUE
+			&& param->transfer != GI_TRANSFER_NOTHING;
+	}
+
+	deferred->copy = copy;
+	deferred->owned = owned;
+	deferred->gtypes = gtypes;
+	deferred->nargs = callable->nargs;
+	return;
+
+ fail:
+	g_free(copy);
+	g_free(owned);
+	g_free(gtypes);
+}
+
+/* Binds deferred callback to the callable of the closure being created (at the top of the stack).  Returns FALSE if the closure has to be called synchronously. */
+static gboolean
+deferred_bind(lua_State *L, Deferred *deferred, Callable *callable)
+{
+	if (deferred->callable == NULL) {
+		lua_pushvalue(L, -1);
+		deferred->callable_ref = luaL_ref(L, LUA_REGISTRYINDEX);
+		deferred->callable = callable;
+		deferred_analyze(deferred, callable);
+	} else if (deferred->callable != callable
+		&& (deferred->callable->info == NULL || callable->info == NULL
+			|| !gi_base_info_equal(GI_BASE_INFO(deferred->callable->info),
+				GI_BASE_INFO(callable->info))))
+		return FALSE;
+	return deferred->copy != NULL;
+}
+
+/* Tears deferred callback down when its userdata is collected, either because nothing refers to it anymore or because the state is being closed.  Must be called with state lock held.  Destroys the source, frees pending calls without delivering them and releases Lua references; calls queued later are dropped by closure_defer(). */
+static void
+deferred_teardown(lua_State *L, Deferred *deferred)
+{
+	DeferredCall *call;
+
+	g_mutex_lock(&deferred->mutex);
+	deferred->closed = TRUE;
+	call = deferred->head;
+	deferred->head = NULL;
+	g_mutex_unlock(&deferred->mutex);
+
+	g_source_destroy(deferred->source);
+	g_source_unref(deferred->source);
+	deferred->source = NULL;
+	while (call != NULL) {
+		DeferredCall *next = call->next;
+		deferred_call_free(deferred, call);
+		call = next;
+	}
+
+	luaL_unref(L, LUA_REGISTRYINDEX, deferred->target_ref);
+	luaL_unref(L, LUA_REGISTRYINDEX, deferred->callable_ref);
+	luaL_unref(L, LUA_REGISTRYINDEX, deferred->callback.thread_ref);
+	deferred->callable = NULL;
+	deferred_unref(deferred);
+}
+
+/* Delivers single queued call, runs in protected mode. Lua prototype: deferred_deliver(deferred_lightuserdata, call_lightuserdata) */
+static int
+deferred_deliver(lua_State *L)
+{
+	Deferred *deferred = lua_touserdata(L, 1);
+	DeferredCall *call = lua_touserdata(L, 2);
+	Callable *callable = deferred->callable;
+	int i, npos = 0;
+
+	lua_settop(L, 0);
+	lua_rawgeti(L, LUA_REGISTRYINDEX, deferred->target_ref);
+	for (i = 0; i < callable->nargs; i++) {
+		Param *param = &callable->params[i];
+		if (deferred->copy[i] == DEFERRED_COPY_NONE)
+			continue;
+
+		/* Pointer arguments are owned by the call, either copied or passed to us with transfer-full, so hand them over to Lua. */
+		lua_gobject_marshal_2lua(L, param->ti, &param->ai, GI_DIRECTION_IN,
+			deferred->copy[i] == DEFERRED_COPY_VALUE
+				? GI_TRANSFER_NOTHING : GI_TRANSFER_EVERYTHING,
+			&call->args[i], 0, callable->info, NULL);
+		call->args[i].v_pointer = NULL;
+		npos++;
+	}
+	lua_call(L, npos, 0);
+	return 0;
+}
+
+static gboolean
+deferred_dispatch(GSource *source, GSourceFunc callback, gpointer user_data)
+{
+	Deferred *deferred =((DeferredSource *) source)->deferred;
+	gpointer state_lock = deferred->callback.state_lock;
+	DeferredCall *call, *calls = NULL;
+	gboolean closed;
+	lua_State *L;
+	(void)callback;
+	(void)user_data;
+
+	/* Disarm before taking the queue, so that calls pushed from now on wake us up again.  Torn down callback's state might be gone, so its lock must not be touched. */
+	g_source_set_ready_time(source, -1);
+	g_mutex_lock(&deferred->mutex);
+	closed = deferred->closed;
+	g_mutex_unlock(&deferred->mutex);
+	if (closed)
+		return G_SOURCE_REMOVE;
+
+	lua_gobject_state_enter(state_lock);
+
+	/* Take all pending calls at once and reverse them into FIFO order.  The queue is empty if the callback was torn down meanwhile. */
+	g_mutex_lock(&deferred->mutex);
+	call = deferred->head;
+	deferred->head = NULL;
+	g_mutex_unlock(&deferred->mutex);
+	while (call != NULL) {
+		DeferredCall *next = call->next;
+		call->next = calls;
+		calls = call;
+		call = next;
+	}
+
+	/* Deliver all of them in single entry.  Delivered callbacks may drop the last reference to deferred userdata, so stop delivering once it is torn down. */
+	L = deferred->callback.L;
+	while (calls != NULL) {
+		call = calls;
+		calls = call->next;
+		if (!deferred->closed) {
+			lua_pushcfunction(L, deferred_deliver);
+			lua_pushlightuserdata(L, deferred);
+			lua_pushlightuserdata(L, call);
+			if (lua_pcall(L, 2, 0, 0) != 0) {
+				g_warning("Error raised while delivering deferred callback: %s",
+					lua_tostring(L, -1));
+				lua_pop(L, 1);
+			}
+		}
+		deferred_call_free(deferred, call);
+	}
+
+	lua_gobject_state_leave(state_lock);
+	return G_SOURCE_CONTINUE;
+}
+
+/* Source holds reference to deferred, so that it stays valid while the source is being dispatched. */
+static void
+deferred_finalize(GSource *source)
+{
+	deferred_unref(((DeferredSource *) source)->deferred);
+}
+
+static GSourceFuncs deferred_source_funcs = {
+	NULL, NULL, deferred_dispatch, deferred_finalize, NULL, NULL
+};
+
+/* Appends the trampoline of the closure into the perf map, so that profilers can name it. */
+static void
+perfmap_write(lua_State *L, Callable *callable, gpointer call_addr)
+{
+#ifdef FFI_TRAMPOLINE_SIZE
+	gsize size = FFI_TRAMPOLINE_SIZE;
+#else
+	gsize size = sizeof(ffi_closure);
+#endif
+	if (callable->info != NULL) {
+		luaL_checkstack(L, 4, "");
+		lua_concat(L, lua_gobject_type_get_name(L,
+			GI_BASE_INFO(callable->info)));
+	} else
+		lua_pushliteral(L, "lua_gobject");
+
+	G_LOCK(perfmap);
+	if (perfmap != NULL) {
+		fprintf(perfmap, "%" G_GSIZE_MODIFIER "x %" G_GSIZE_MODIFIER
+			"x %s callback\n", (gsize) call_addr, size, lua_tostring(L, -1));
+		fflush(perfmap);
+	}
+	G_UNLOCK(perfmap);
+	lua_pop(L, 1);
+}
+
+/* Opens or closes the perf map of this process, returns previous state. */
+static gboolean
+perfmap_enable(gboolean enable)
+{
+	gboolean previous;
+	G_LOCK(perfmap);
+	previous = perfmap != NULL;
+#ifdef G_OS_UNIX
+	if (enable && perfmap == NULL) {
+		gchar *path = g_strdup_printf("/tmp/perf-%d.map", (int) getpid());
+		perfmap = fopen(path, "a");
+		g_free(path);
+	}
+#endif
+	if (!enable && perfmap != NULL) {
+		fclose(perfmap);
+		perfmap = NULL;
+	}
+	G_UNLOCK(perfmap);
+	return previous;
+}
+
+/* Lua prototype: enabled = core.callable.eager([enable]); returns previous state. */
+static int
+callable_eager(lua_State *L)
+{
+	gboolean previous;
+	if (lua_isnoneornil(L, 1))
+		previous = g_atomic_int_get(&pending_eager);
+	else
+		previous = pending_enable(lua_toboolean(L, 1));
+	lua_pushboolean(L, previous);
+	return 1;
+}
+
+/* Lua prototype: enabled = core.perfmap([enable]); returns previous state. */
+static int
+callable_perfmap(lua_State *L)
+{
+	gboolean previous;
+	if (lua_isnoneornil(L, 1))
+		previous = perfmap != NULL;
+	else
+		previous = perfmap_enable(lua_toboolean(L, 1));
+	lua_pushboolean(L, previous);
+	return 1;
+}
+
 /* Creates closure from Lua function to be passed to C. */
 gpointer
 lua_gobject_closure_create(lua_State *L, gpointer user_data,
@@ -1347,7 +2389,19 @@ lua_gobject_closure_create(lua_State *L, gpointer user_data,
 
 	/* Prepare callable and store reference to it. */
 	callable = lua_touserdata(L, -1);
+	callable_prepare(L, callable);
 	call_addr = closure->call_addr;
+	closure->deferred = NULL;
+	closure->profile = NULL;
+	closure->profile_generation = 0;
+	if (!lua_isthread(L, target)) {
+		Deferred **deferred = lua_gobject_udata_test(L, target, UD_DEFERRED);
+		if (deferred != NULL && deferred_bind(L, *deferred, callable)) {
+			/* Foreign threads may invoke the closure even after the callback is torn down. */
+			closure->deferred = *deferred;
+			g_atomic_int_inc(&closure->deferred->ref_count);
+		}
+	}
 	closure->created = 1;
 	closure->autodestroy = autodestroy;
 	closure->callable_ref = luaL_ref(L, LUA_REGISTRYINDEX);
@@ -1370,9 +2424,170 @@ lua_gobject_closure_create(lua_State *L, gpointer user_data,
 		return NULL;
 	}
 
+	if (G_UNLIKELY(perfmap != NULL))
+		perfmap_write(L, callable, call_addr);
+
 	return call_addr;
 }
 
+/* Drops one pending operation of the trampoline, releases references when none is left. */
+static void
+async_ready_release(lua_State *L, AsyncReady *ready)
+{
+	if (--ready->pending == 0) {
+		luaL_unref(L, LUA_REGISTRYINDEX, ready->callback.thread_ref);
+		luaL_unref(L, LUA_REGISTRYINDEX, ready->self_ref);
+		ready->callback.thread_ref = ready->self_ref = LUA_NOREF;
+	}
+}
+
+/* Native GAsyncReadyCallback, resumes the thread which bound the trampoline with (source_object, result) arguments. */
+static void
+async_ready_callback(GObject *source, GAsyncResult *result, gpointer user_data)
+{
+	AsyncReady *ready = user_data;
+	gpointer state_lock = ready->callback.state_lock;
+	lua_State *L = ready->callback.L;
+	lua_State *marshal_L;
+	int res, stacktop;
+
+	lua_gobject_state_enter(state_lock);
+	if (lua_status(L) != LUA_YIELD) {
+		g_warning("async callback: thread is not suspended, cannot resume");
+		async_ready_release(L, ready);
+		lua_gobject_state_leave(state_lock);
+		return;
+	}
+
+	/* Marshal arguments using marshalling thread, because target one is suspended. */
+	lua_pushlightuserdata(L, &marshalling_L_address);
+	lua_rawget(L, LUA_REGISTRYINDEX);
+	marshal_L = lua_tothread(L, -1);
+	lua_pop(L, 1);
+	stacktop = lua_gettop(L);
+	lua_gobject_object_2lua(marshal_L, source, FALSE, FALSE);
+	lua_gobject_object_2lua(marshal_L, result, FALSE, FALSE);
+	lua_xmove(marshal_L, L, 2);
+
+	/* Resume the thread.  References are still held, so that neither the thread nor the trampoline can be collected while running. */
+#if LUA_VERSION_NUM >= 504
+	{
+		int nresults;
+		res = lua_resume(L, NULL, 2, &nresults);
+	}
+#elif LUA_VERSION_NUM >= 502
+	res = lua_resume(L, NULL, 2);
+#else
+	res = lua_resume(L, 2);
+#endif
+	if (res != 0 && res != LUA_YIELD)
+		g_warning("Error raised while resuming async callback: %s",
+			lua_tostring(L, -1));
+
+	if (stacktop > lua_gettop(L))
+		stacktop = lua_gettop(L);
+	lua_settop(L, stacktop);
+	async_ready_release(marshal_L, ready);
+	lua_gobject_state_leave(state_lock);
+}
+
+/* Records trampoline at narg in preallocated closure block in *user_data; callable_call() replaces the block with the trampoline once all arguments are marshalled. Returns callback address or NULL if the trampoline cannot be used. */
+gpointer
+lua_gobject_async_ready_bind(lua_State *L, int narg, gpointer *user_data)
+{
+	AsyncReady *ready = lua_gobject_udata_test(L, narg, LUA_GOBJECT_ASYNC_READY);
+	FfiClosureBlock *block = *user_data;
+	if (ready == NULL || block == NULL || block->closures_count != 0
+			|| block->async_ready != NULL)
+		return NULL;
+
+	/* Trampoline is already bound to another thread. */
+	if (ready->pending != 0 && ready->callback.L != L)
+		return NULL;
+
+	lua_gobject_makeabs(L, narg);
+	block->async_ready = ready;
+	block->async_ready_narg = narg;
+	return async_ready_callback;
+}
+
+/* Creates new persistent async-ready trampoline. Lua prototype:
+ready = callable.async_ready() */
+static int
+callable_async_ready(lua_State *L)
+{
+	AsyncReady *ready = lua_newuserdata(L, sizeof(AsyncReady));
+	ready->callback.L = NULL;
+	ready->callback.thread_ref = LUA_NOREF;
+	ready->callback.state_lock = NULL;
+	ready->self_ref = LUA_NOREF;
+	ready->pending = 0;
+	luaL_getmetatable(L, LUA_GOBJECT_ASYNC_READY);
+	lua_setmetatable(L, -2);
+	return 1;
+}
+
+/* Creates new deferred callback. Lua prototype:
+deferred = callable.deferred(target[, context]) */
+static int
+callable_deferred(lua_State *L)
+{
+	GMainContext *context = NULL;
+	Deferred *deferred, **ud;
+
+	luaL_checkany(L, 1);
+	if (!lua_isnoneornil(L, 2)) {
+		lua_gobject_type_get_repotype(L, G_TYPE_MAIN_CONTEXT, NULL);
+		lua_gobject_record_2c(L, 2, &context, FALSE, FALSE, FALSE, FALSE);
+	} else
+		context = g_main_context_get_thread_default();
+
+	ud = lua_newuserdata(L, sizeof(Deferred *));
+	deferred = *ud = g_new0(Deferred, 1);
+	deferred->ref_count = 2;
+	g_mutex_init(&deferred->mutex);
+	deferred->owner = g_thread_self();
+	deferred->callback.L = lua_newthread(L);
+	deferred->callback.thread_ref = luaL_ref(L, LUA_REGISTRYINDEX);
+	deferred->callback.state_lock = lua_gobject_state_get_lock(L);
+	lua_pushvalue(L, 1);
+	deferred->target_ref = luaL_ref(L, LUA_REGISTRYINDEX);
+	deferred->callable_ref = LUA_NOREF;
+	deferred->source = g_source_new(&deferred_source_funcs,
+		sizeof(DeferredSource));
+	((DeferredSource *) deferred->source)->deferred = deferred;
+	g_source_set_name(deferred->source, "LuaGObject deferred callback");
+	g_source_set_ready_time(deferred->source, -1);
+	g_source_attach(deferred->source, context);
+	luaL_getmetatable(L, UD_DEFERRED);
+	lua_setmetatable(L, -2);
+	return 1;
+}
+
+static int
+deferred_gc(lua_State *L)
+{
+	deferred_teardown(L, *(Deferred **) lua_touserdata(L, 1));
+	return 0;
+}
+
+/* Synchronous invocation, used when called from the owner thread or when the callback cannot be deferred. */
+static int
+deferred_call(lua_State *L)
+{
+	Deferred *deferred = *(Deferred **) lua_touserdata(L, 1);
+	lua_rawgeti(L, LUA_REGISTRYINDEX, deferred->target_ref);
+	lua_replace(L, 1);
+	lua_call(L, lua_gettop(L) - 1, LUA_MULTRET);
+	return lua_gettop(L);
+}
+
+static const struct luaL_Reg deferred_reg[] = {
+	{ "__gc", deferred_gc },
+	{ "__call", deferred_call },
+	{ NULL, NULL }
+};
+
 /* Creates new Callable instance according to given gi.info. Lua prototype:
 callable = callable.new(callable_info[, addr]) or
 callable = callable.new(description_table[, addr]) */
@@ -1388,15 +2603,384 @@ callable_new(lua_State *L)
 			addr);
 }
 
+/* Single invocation of parallel_map. */
+typedef struct _ParallelCall {
+	GIArgument retval;
+	GError *err;
+	GIArgument *args;
+	void **ffi_args;
+	void **redirect_out;
+} ParallelCall;
+
+/* GThreadPool function performing single call of parallel_map. */
+static void
+parallel_call(gpointer data, gpointer user_data)
+{
+	ParallelCall *call = data;
+	Callable *callable = user_data;
+	ffi_call(&callable->cif, callable->address, &call->retval, call->ffi_args);
+}
+
+/* Lua prototype: results = core.callable.parallel_map(callable, inputs[, options])
+ Calls callable once for every table of arguments in inputs array, from up to options.threads threads at once.  All arguments are marshalled before the first call and all results after the last one; the state lock is not held while the calls run.  Returns array of tables with results of each call, with field n holding number of results. */
+static int
+callable_parallel_map(lua_State *L)
+{
+	Callable *callable = callable_get(L, 1);
+	int count, nargs, i, j, threads = g_get_num_processors(), base, kept = 0;
+	gpointer state_lock = lua_gobject_state_get_lock(L);
+	GThreadPool *pool;
+	gsize size;
+	guint8 *block;
+	Param *param;
+
+	luaL_checktype(L, 2, LUA_TTABLE);
+	if (!lua_isnoneornil(L, 3)) {
+		luaL_checktype(L, 3, LUA_TTABLE);
+		lua_getfield(L, 3, "threads");
+		if (!lua_isnil(L, -1)) {
+			if (lua_type(L, -1) != LUA_TNUMBER)
+				return luaL_argerror(L, 3, lua_pushfstring(L,
+					"field 'threads' must be a number, got %s",
+					luaL_typename(L, -1)));
+			threads = (int) lua_tointeger(L, -1);
+		}
+		lua_pop(L, 1);
+		luaL_argcheck(L, threads > 0, 3,
+			"field 'threads' must be a positive number");
+	}
+
+	callable_prepare(L, callable);
+
+	/* Only explicitly marked callables without closures and caller-allocated arguments are supported; their arguments can be marshalled in advance. */
+	if (!callable->thread_safe) {
+		callable_describe(L, callable, NULL);
+		return luaL_error(L, "%s: not marked as thread_safe",
+			lua_tostring(L, -1));
+	}
+	for (i = 0, param = callable->params; i < callable->nargs; i++, param++)
+		if (param->n_closures > 0 || (param->dir == GI_DIRECTION_OUT
+				&& callable->info
+				&& gi_arg_info_is_caller_allocates(&param->ai))) {
+			callable_describe(L, callable, NULL);
+			return luaL_error(L, "%s: cannot be called in parallel",
+				lua_tostring(L, -1));
+		}
+
+	/* Allocate all calls in single block, guarded until the results are marshalled. */
+	count = lua_objlen(L, 2);
+	nargs = callable->nargs + callable->has_self;
+	size = sizeof(ParallelCall) + nargs * sizeof(GIArgument)
+		+ 2 * (nargs + callable->throws) * sizeof(void *);
+	block = g_malloc0(size * MAX(count, 1));
+	*lua_gobject_guard_create(L, g_free) = block;
+	base = lua_gettop(L);
+	lua_newtable(L);
+
+	/* Marshal arguments of all calls.  Inputs and temporary values created by marshalling are moved to the table at base + 1, which keeps them alive until all calls are finished. */
+	for (i = 0; i < count; i++) {
+		ParallelCall *call = (ParallelCall *) (block + i * size);
+		int input, argi = 1;
+		call->args = (GIArgument *) (call + 1);
+		call->ffi_args = (void **) (call->args + nargs);
+		call->redirect_out = call->ffi_args + nargs + callable->throws;
+
+		luaL_checkstack(L, callable->nargs + 4, "");
+		lua_rawgeti(L, 2, i + 1);
+		if (!lua_istable(L, -1))
+			return luaL_error(L, "inputs[%d]: table of arguments expected",
+				i + 1);
+		input = lua_gettop(L);
+
+		if (callable->has_self) {
+			GIBaseInfo *parent = gi_base_info_get_container(
+				GI_BASE_INFO(callable->info));
+			lua_rawgeti(L, input, argi++);
+			if (GI_IS_OBJECT_INFO(parent) || GI_IS_INTERFACE_INFO(parent))
+				call->args[0].v_pointer =
+					lua_gobject_object_2c(L, -1,
+						gi_registered_type_info_get_g_type(
+							GI_REGISTERED_TYPE_INFO(parent)),
+						FALSE, FALSE, FALSE);
+			else {
+				lua_gobject_type_get_repotype(L, G_TYPE_INVALID, parent);
+				lua_gobject_record_2c(L, -2, &call->args[0].v_pointer,
+					FALSE, FALSE, FALSE, FALSE);
+			}
+			call->ffi_args[0] = &call->args[0];
+		}
+
+		for (j = 0, param = callable->params; j < callable->nargs;
+				j++, param++) {
+			int k = j + callable->has_self;
+			if (param->dir == GI_DIRECTION_IN)
+				call->ffi_args[k] = &call->args[k];
+			else {
+				call->ffi_args[k] = &call->redirect_out[k];
+				call->redirect_out[k] = &call->args[k];
+			}
+		}
+
+		for (j = 0, param = callable->params; j < callable->nargs;
+				j++, param++)
+			if (!param->internal) {
+				if (param->dir != GI_DIRECTION_OUT) {
+					lua_rawgeti(L, input, argi++);
+					callable_param_2c(L, param, lua_gettop(L), 0,
+						&call->args[j + callable->has_self], 1, callable,
+						call->ffi_args);
+				}
+			} else if (param->internal_user_data)
+				call->args[j + callable->has_self].v_pointer =
+					callable->user_data;
+
+		if (callable->throws) {
+			call->redirect_out[nargs] = &call->err;
+			call->ffi_args[nargs] = &call->redirect_out[nargs];
+		}
+
+		while (lua_gettop(L) > base + 1)
+			lua_rawseti(L, base + 1, ++kept);
+	}
+
+	/* Run the calls with the state unlocked. */
+	lua_gobject_state_leave(state_lock);
+	pool = g_thread_pool_new(parallel_call, callable,
+		MAX(MIN(threads, count), 1), FALSE, NULL);
+	for (i = 0; i < count; i++) {
+		ParallelCall *call = (ParallelCall *) (block + i * size);
+		if (pool == NULL || !g_thread_pool_push(pool, call, NULL))
+			parallel_call(call, callable);
+	}
+	if (pool != NULL)
+		g_thread_pool_free(pool, FALSE, TRUE);
+	lua_gobject_state_enter(state_lock);
+
+	/* Collect the results. */
+	lua_createtable(L, count, 0);
+	for (i = 0; i < count; i++) {
+		ParallelCall *call = (ParallelCall *) (block + i * size);
+		int nret = 0;
+		luaL_checkstack(L, callable->nargs + 4, "");
+		lua_newtable(L);
+		if (!callable->ignore_retval
+				&& (callable->retval.ti == NULL
+					|| (gi_type_info_get_tag(callable->retval.ti)
+						!= GI_TYPE_TAG_VOID
+					|| gi_type_info_is_pointer(callable->retval.ti)))) {
+			callable_param_2lua(L, &callable->retval, &call->retval,
+				LUA_GOBJECT_PARENT_IS_RETVAL, 1, callable, call->ffi_args);
+			lua_rawseti(L, -2, ++nret);
+		} else if (callable->ignore_retval) {
+			union {
+				GIArgument arg;
+				ffi_sarg s;
+			} *ru =(gpointer) &call->retval;
+			ru->arg.v_boolean =(gboolean) ru->s;
+		}
+
+		if (call->err != NULL) {
+			if (nret == 0) {
+				lua_pushboolean(L, 0);
+				lua_rawseti(L, -2, ++nret);
+			}
+			lua_gobject_type_get_repotype(L, G_TYPE_ERROR, NULL);
+			lua_gobject_record_2lua(L, call->err, TRUE, 0);
+			lua_rawseti(L, -2, ++nret);
+		} else {
+			for (j = 0, param = callable->params; j < callable->nargs;
+					j++, param++)
+				if (!param->internal && param->dir != GI_DIRECTION_IN) {
+					if (callable->ignore_retval && !call->retval.v_boolean)
+						lua_pushnil(L);
+					else
+						callable_param_2lua(L, param,
+							&call->args[j + callable->has_self], 0, 1,
+							callable, call->ffi_args);
+					lua_rawseti(L, -2, ++nret);
+				}
+			if (nret == 0 && callable->throws) {
+				lua_pushboolean(L, 1);
+				lua_rawseti(L, -2, ++nret);
+			}
+		}
+
+		lua_pushinteger(L, nret);
+		lua_setfield(L, -2, "n");
+		lua_rawseti(L, -2, i + 1);
+	}
+
+	/* Drop the guard and temporaries of the marshalled arguments, keep only the results. */
+	lua_replace(L, base);
+	lua_settop(L, base);
+	return 1;
+}
+
+/* Lua prototype: previous = core.callable.single_threaded([enabled])
+ In single-threaded mode, the state lock is not released around any call, so threads other than the one running Lua can never enter it.  The mode applies only to the calling state. */
+static int
+callable_single_threaded(lua_State *L)
+{
+	gpointer state_lock = lua_gobject_state_get_lock(L);
+	lua_pushboolean(L, lua_gobject_state_get_single_threaded(state_lock));
+	if (!lua_isnone(L, 1))
+		lua_gobject_state_set_single_threaded(state_lock,
+			lua_toboolean(L, 1));
+	return 1;
+}
+
+static int
+profile_gc(lua_State *L)
+{
+	Profile *profile = lua_touserdata(L, 1);
+	if (profile->running)
+		g_atomic_int_add(&profile_active, -1);
+	g_hash_table_destroy(profile->entries);
+	g_hash_table_destroy(profile->samples);
+	return 0;
+}
+
+static Profile *
+profile_get(lua_State *L)
+{
+	Profile *profile;
+	lua_pushlightuserdata(L, &profile_key);
+	lua_rawget(L, LUA_REGISTRYINDEX);
+	profile = lua_touserdata(L, -1);
+	lua_pop(L, 1);
+	return profile;
+}
+
+/* Lua prototype: core.profile.start([options])
+ Discards all collected data and starts profiling calls and closures of this state.  When options.sample is N, every Nth call or closure is also sampled together with its Lua stack. */
+static int
+profile_start(lua_State *L)
+{
+	Profile *profile = profile_get(L);
+	lua_Integer every = 0;
+	if (!lua_isnoneornil(L, 1)) {
+		luaL_checktype(L, 1, LUA_TTABLE);
+		lua_getfield(L, 1, "sample");
+		every = luaL_optinteger(L, -1, 0);
+		luaL_argcheck(L, every >= 0 && every <= G_MAXUINT, 1,
+			"bad sample interval");
+		lua_pop(L, 1);
+	}
+	profile->sample_every = profile->sample_countdown = (guint) every;
+	g_hash_table_remove_all(profile->samples);
+	g_hash_table_remove_all(profile->entries);
+	profile->generation = g_atomic_int_add(&profile_generation, 1) + 1;
+	if (!profile->running) {
+		profile->running = TRUE;
+		g_atomic_int_add(&profile_active, 1);
+	}
+	return 0;
+}
+
+/* Lua prototype: core.profile.stop() */
+static int
+profile_stop(lua_State *L)
+{
+	Profile *profile = profile_get(L);
+	if (profile->running) {
+		profile->running = FALSE;
+		g_atomic_int_add(&profile_active, -1);
+	}
+	return 0;
+}
+
+static gint
+profile_compare(gconstpointer a, gconstpointer b)
+{
+	const ProfileEntry *ea = *(ProfileEntry **) a, *eb = *(ProfileEntry **) b;
+	gint64 ta = ea->phases[0] + ea->phases[1] + ea->phases[2];
+	gint64 tb = eb->phases[0] + eb->phases[1] + eb->phases[2];
+	return ta < tb ? 1 : (ta > tb ? -1 : 0);
+}
+
+/* Lua prototype: report = core.profile.report()
+ Returns array of collected entries sorted by total time, each entry being table { name, kind, calls, marshal, call, unmarshal, total }.  All times are in nanoseconds; for closures, 'call' is time spent in Lua code. */
+static int
+profile_report(lua_State *L)
+{
+	static const char *const phases[] = { "marshal", "call", "unmarshal" };
+	Profile *profile = profile_get(L);
+	GPtrArray *entries = g_hash_table_get_values_as_ptr_array(profile->entries);
+	guint i;
+	int phase;
+
+	g_ptr_array_sort(entries, profile_compare);
+	lua_createtable(L, entries->len, 0);
+	for (i = 0; i < entries->len; i++) {
+		ProfileEntry *entry = g_ptr_array_index(entries, i);
+		lua_createtable(L, 0, 7);
+		lua_pushstring(L, entry->name);
+		lua_setfield(L, -2, "name");
+		lua_pushstring(L, entry->closure ? "closure" : "callable");
+		lua_setfield(L, -2, "kind");
+		lua_pushnumber(L, (lua_Number) entry->calls);
+		lua_setfield(L, -2, "calls");
+		for (phase = 0; phase < 3; phase++) {
+			lua_pushnumber(L, (lua_Number) entry->phases[phase]);
+			lua_setfield(L, -2, phases[phase]);
+		}
+		lua_pushnumber(L, (lua_Number) (entry->phases[0] + entry->phases[1]
+				+ entry->phases[2]));
+		lua_setfield(L, -2, "total");
+		lua_rawseti(L, -2, i + 1);
+	}
+	g_ptr_array_unref(entries);
+	return 1;
+}
+
+/* Lua prototype: stacks = core.profile.folded(['time'])
+ Returns collected samples as folded stacks, one 'frame;frame;crossing weight' line per distinct stack, weighted by sample count or by nanoseconds spent in sampled crossings. */
+static int
+profile_folded(lua_State *L)
+{
+	static const char *const weights[] = { "count", "time", NULL };
+	Profile *profile = profile_get(L);
+	int by_time = luaL_checkoption(L, 1, "count", weights);
+	GString *folded = g_string_new(NULL);
+	GHashTableIter iter;
+	gpointer key, value;
+
+	g_hash_table_iter_init(&iter, profile->samples);
+	while (g_hash_table_iter_next(&iter, &key, &value)) {
+		ProfileSample *sample = value;
+		g_string_append_printf(folded, "%s %" G_GINT64_FORMAT "\n",
+			(const gchar *) key,
+			by_time ? sample->time : (gint64) sample->count);
+	}
+	lua_pushlstring(L, folded->str, folded->len);
+	g_string_free(folded, TRUE);
+	return 1;
+}
+
+static const luaL_Reg profile_api_reg[] = {
+	{ "start", profile_start },
+	{ "stop", profile_stop },
+	{ "report", profile_report },
+	{ "folded", profile_folded },
+	{ NULL, NULL }
+};
+
 /* Callable module public API table. */
 static const luaL_Reg callable_api_reg[] = {
 	{ "new", callable_new },
+	{ "async_ready", callable_async_ready },
+	{ "deferred", callable_deferred },
+	{ "parallel_map", callable_parallel_map },
+	{ "single_threaded", callable_single_threaded },
+	{ "eager", callable_eager },
 	{ NULL, NULL }
 };
 
 void
 lua_gobject_callable_init(lua_State *L)
 {
+	Profile *profile;
+
 	/* Create a thread for marshalling arguments to yielded threads, register it so that it is not GC'd. */
 	lua_pushlightuserdata(L, &marshalling_L_address);
 	lua_newthread(L);
@@ -1408,11 +2992,48 @@ lua_gobject_callable_init(lua_State *L)
 	luaL_register(L, NULL, callable_reg);
 	lua_rawset(L, LUA_REGISTRYINDEX);
 
+	/* Register async-ready trampoline metatable. */
+	luaL_newmetatable(L, LUA_GOBJECT_ASYNC_READY);
+	lua_pop(L, 1);
+
+	/* Register deferred callback metatable. */
+	luaL_newmetatable(L, UD_DEFERRED);
+	luaL_register(L, NULL, deferred_reg);
+	lua_pop(L, 1);
+
 	/* Create cache for callables. */
 	lua_gobject_cache_create(L, &callable_cache, NULL);
 
+	/* Create profiler of this state. */
+	lua_pushlightuserdata(L, &profile_key);
+	profile = lua_newuserdata(L, sizeof(Profile));
+	profile->running = FALSE;
+	profile->generation = 0;
+	profile->entries = g_hash_table_new_full(g_str_hash, g_str_equal,
+		NULL, profile_entry_free);
+	profile->sample_every = profile->sample_countdown = 0;
+	profile->samples = g_hash_table_new_full(g_str_hash, g_str_equal,
+		g_free, g_free);
+	lua_newtable(L);
+	lua_pushcfunction(L, profile_gc);
+	lua_setfield(L, -2, "__gc");
+	lua_setmetatable(L, -2);
+	lua_rawset(L, LUA_REGISTRYINDEX);
+
 	/* Create public api for callable module. */
 	lua_newtable(L);
 	luaL_register(L, NULL, callable_api_reg);
 	lua_setfield(L, -2, "callable");
+
+	/* Create public api for profiler. */
+	lua_newtable(L);
+	luaL_register(L, NULL, profile_api_reg);
+	lua_setfield(L, -2, "profile");
+
+	lua_pushcfunction(L, callable_perfmap);
+	lua_setfield(L, -2, "perfmap");
+	if (g_getenv("LUAGOBJECT_PERFMAP") != NULL)
+		perfmap_enable(TRUE);
+	if (g_getenv("LUAGOBJECT_EAGER_RESOLVE") != NULL)
+		pending_enable(TRUE);
 }
@@ -23,14 +23,13 @@ function component.get_category(children, xform_value,
 	-- Early shortcircuit; no elements, no table needed at all.
 	if #children == 0 then return nil end
 
-	-- Index contains array of indices which were still not retrieved from 'children' table, and table part contains name->index mapping.
-	local index, mt = {}, {}
-	for i = 1, #children do index[i] = i end
+	-- Index contains name->index mapping of children which were still not retrieved from 'children' table.  It is built by the core in a single pass, so that no lookup has to walk through the children.
+	local index, mt = core.gi.names(children), {}
 
 	-- Fully resolves the category (i.e. loads everything remaining to be loaded in given category) and disconnects on-demand loading metatable.
 	local function resolve(category)
-		-- Load al values from unknown indices.
-		local ei, en, val
+		-- Load all values not retrieved yet.
+		local val
 		local function xvalue(arg)
 			if not xform_value then return arg end
 			if arg then
@@ -39,17 +38,6 @@ function component.get_category(children, xform_value,
 			end
 		end
 
-		while #index > 0 do
-			ei = children[table.remove(index)]
-			val = xvalue(ei)
-			if val then
-				en = ei.name
-				en = not xform_name_reverse and en or xform_name_reverse(en)
-				if en then category[en] = val end
-			end
-		end
-
-		-- The non-numeric indices still need to be iterated on, if any exist.
 		for en, idx in pairs(index) do
 			val = xvalue(children[idx])
 			local name = not xform_name_reverse and en
@@ -70,22 +58,11 @@ function component.get_category(children, xform_value,
 			or xform_name(requested_name)
 		if not name then return end
 
-		-- Check, whether we already know its index.
+		-- Get the info directly by its index.
 		local idx, val = index[name]
 		if idx then
-			-- We know at least the index, so get info directly.
 			val = children[idx]
 			index[name] = nil
-		else
-			-- Not yet, go through unknown indices and try to find the name.
-			while #index > 0 do
-				idx = table.remove(index)
-				val = children[idx]
-				local en = val.name
-				if en == name then break end
-				val = nil
-				index[en] = idx
-			end
 		end
 
 		-- If there is nothing in the index, we can disconnect metatable, because everything is already loaded.
@@ -197,6 +174,14 @@ function component.mt:_element(instance, symbol, origin)
 		end
 	end
 	if element then
+		-- Methods listed in '_nolock' annotation (or all methods, if it is true) keep the state lock locked during the call.
+		if category == '_method' and type(element) == 'userdata' then
+			local nolock = rawget(self, '_nolock')
+			if nolock == true or (nolock and nolock[symbol]) then
+				element.nolock = true
+			end
+		end
+
 		-- Make sure that table-based attributes have symbol name, so that potential errors contain the name of referenced attribute.
 		if type(element) == 'table' and category == '_attribute' then
 			element._name = element._name or symbol
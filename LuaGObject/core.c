@@ -8,6 +8,14 @@ Core C utility API.
 #include <string.h>
 #include "lua_gobject.h"
 
+#ifdef LUA_GOBJECT_USDT
+/* Semaphores of static tracepoints, placed where the tracers look for them. */
+#define LUA_GOBJECT_PROBE_DEFINE(name) \
+	unsigned short luagobject_ ## name ## _semaphore \
+	__attribute__((section(".probes")));
+LUA_GOBJECT_PROBES(LUA_GOBJECT_PROBE_DEFINE)
+#endif
+
 /* GLib 2.32 deprecated GStaticRecMutex in favor of GRecMutex. For older GLib versions, use still older version. */
 #if !GLIB_CHECK_VERSION(2, 32, 0)
 #define GRecMutex GStaticRecMutex
@@ -233,6 +241,7 @@ guard_gc(lua_State *L)
 	Guard *guard = lua_touserdata(L, 1);
 	if (guard->data != NULL)
 	guard->destroy(guard->data);
+	lua_gobject_alloc_account(LUA_GOBJECT_ALLOC_GUARD, -(gssize) sizeof(Guard));
 	return 0;
 }
 
@@ -245,6 +254,7 @@ lua_gobject_guard_create(lua_State *L, GDestroyNotify destroy)
 	lua_setmetatable(L, -2);
 	guard->data = NULL;
 	guard->destroy = destroy;
+	lua_gobject_alloc_account(LUA_GOBJECT_ALLOC_GUARD, sizeof(Guard));
 	return &guard->data;
 }
 
@@ -284,21 +294,139 @@ core_constant(lua_State *L)
 	return 1;
 }
 
+/* Number of buckets of lock time histograms; bucket i counts durations shorter than 2^i microseconds. */
+#define LOCK_HISTOGRAM_SIZE 24
+
+/* Number of the longest lock holders reported by core.stats(). */
+#define LOCK_TOP_HOLDERS 10
+
+/* Time statistics of either waiting for the lock or holding it, in microseconds. */
+typedef struct _LockTimes
+{
+	gint64 total, max;
+	guint64 histogram[LOCK_HISTOGRAM_SIZE];
+} LockTimes;
+
+/* Accumulated lock hold times of single callable or closure. */
+typedef struct _LockHolder
+{
+	GIBaseInfo *info;
+	gboolean closure;
+	guint64 count;
+	gint64 total, max;
+} LockHolder;
+
+/* Lock instrumentation data.  Modified only by the thread holding the lock. */
+typedef struct _LockStats
+{
+	guint64 acquisitions, contended;
+	LockTimes wait, hold;
+
+	/* Start of the outermost hold of the current holder. */
+	gint64 hold_start;
+
+	/* Entry of the closure to which the current hold is attributed, owned by holders table. */
+	LockHolder *holder;
+
+	/* LockHolder instances, keyed by info pointer, to which they keep a reference; closures use separate table. */
+	GHashTable *holders[2];
+} LockStats;
+
 typedef struct _LgiStateMutex
 {
 	/* Pointer to either local state lock(next member of this structure) or to global package lock. */
 	GRecMutex *mutex;
 	GRecMutex state_mutex;
+
+	/* Lock instrumentation, NULL unless enabled. */
+	LockStats *stats;
+
+	/* Recursion depth of the current holder.  It is maintained even without instrumentation, so that stats enabled during a nested hold know when the outermost one ends. */
+	int depth;
+
+	/* Set when the lock is never released around calls into C. */
+	gboolean single_threaded;
 } LgiStateMutex;
 
 /* Global package lock(the one used for gdk_threads_enter/clutter_threads_enter) */
 static GRecMutex package_mutex G_REC_MUTEX_INIT;
 
+static void
+lock_holder_free(gpointer data)
+{
+	LockHolder *holder = data;
+	if (holder->info != NULL)
+		gi_base_info_unref(holder->info);
+	g_free(holder);
+}
+
+/* Gets the entry of given callable or closure, creating it when it does not exist yet. */
+static LockHolder *
+lock_holder_get(LockStats *stats, GIBaseInfo *info, gboolean closure)
+{
+	GHashTable *holders = stats->holders[closure];
+	LockHolder *holder = g_hash_table_lookup(holders, info);
+	if (holder == NULL) {
+		holder = g_new0(LockHolder, 1);
+		holder->info = gi_base_info_ref(info);
+		holder->closure = closure;
+		g_hash_table_insert(holders, holder->info, holder);
+	}
+	return holder;
+}
+
+static void
+lock_holder_add(LockHolder *holder, gint64 duration)
+{
+	holder->count++;
+	holder->total += duration;
+	if (duration > holder->max)
+		holder->max = duration;
+}
+
+static LockStats *
+lock_stats_new(void)
+{
+	LockStats *stats = g_new0(LockStats, 1);
+	int i;
+	for (i = 0; i < 2; i++)
+		stats->holders[i] = g_hash_table_new_full(NULL, NULL, NULL,
+			lock_holder_free);
+
+	/* Stats are always created by the thread which currently holds the lock, possibly recursively; the current hold is measured from now on. */
+	stats->hold_start = g_get_monotonic_time();
+	return stats;
+}
+
+static void
+lock_stats_free(LockStats *stats)
+{
+	if (stats != NULL) {
+		g_hash_table_destroy(stats->holders[0]);
+		g_hash_table_destroy(stats->holders[1]);
+		g_free(stats);
+	}
+}
+
+static void
+lock_times_add(LockTimes *times, gint64 duration)
+{
+	int bucket = 0;
+	while (bucket < LOCK_HISTOGRAM_SIZE - 1
+			&& duration >= (G_GINT64_CONSTANT(1) << bucket))
+		bucket++;
+	times->histogram[bucket]++;
+	times->total += duration;
+	if (duration > times->max)
+		times->max = duration;
+}
+
 /* GC method for GRecMutex structure, which lives inside lua_State. */
 static int
 call_mutex_gc(lua_State* L)
 {
 	LgiStateMutex *mutex = lua_touserdata(L, 1);
+	lock_stats_free(mutex->stats);
 	g_rec_mutex_unlock(mutex->mutex);
 	g_rec_mutex_clear(&mutex->state_mutex);
 	return 0;
@@ -326,17 +454,45 @@ lua_gobject_state_enter(gpointer state_lock)
 {
 	LgiStateMutex *mutex = state_lock;
 	GRecMutex *wait_on;
+	gboolean contended = FALSE;
+	gint64 start = 0;
+	LockStats *stats;
+	LUA_GOBJECT_PROBE_START(lock__acquire, probe_start);
+
+	LUA_GOBJECT_PROBE1(lock__wait, state_lock);
+
+	/* Waiting is measured only when instrumentation is on; it cannot be turned on or off while nobody holds the lock. */
+	if (g_atomic_pointer_get(&mutex->stats) != NULL)
+		start = g_get_monotonic_time();
 
 	/* There is a complication with lock switching. During the wait for the lock, someone could call core.registerlock() and thus change the lock protecting the state. Accomodate for this situation. */
 	for (;;) {
 		wait_on = g_atomic_pointer_get(&mutex->mutex);
-		g_rec_mutex_lock(wait_on);
+		if (start == 0)
+			g_rec_mutex_lock(wait_on);
+		else if (!g_rec_mutex_trylock(wait_on)) {
+			contended = TRUE;
+			g_rec_mutex_lock(wait_on);
+		}
 		if (wait_on == mutex->mutex)
 			break;
 
 		/* The lock is changed, unlock this one and wait again. */
 		g_rec_mutex_unlock(wait_on);
 	}
+
+	LUA_GOBJECT_PROBE2(lock__acquire, state_lock,
+		LUA_GOBJECT_PROBE_ELAPSED(probe_start));
+	stats = mutex->stats;
+	if (mutex->depth++ == 0 && stats != NULL) {
+		gint64 now = g_get_monotonic_time();
+		stats->acquisitions++;
+		if (contended)
+			stats->contended++;
+		lock_times_add(&stats->wait, start != 0 ? now - start : 0);
+		stats->hold_start = now;
+		stats->holder = NULL;
+	}
 }
 
 void
@@ -344,9 +500,57 @@ lua_gobject_state_leave(gpointer state_lock)
 {
 	/* Get pointer to the call mutex belonging to this state. */
 	LgiStateMutex *mutex = state_lock;
+	LockStats *stats = mutex->stats;
+	if (--mutex->depth == 0 && stats != NULL) {
+		gint64 duration = g_get_monotonic_time() - stats->hold_start;
+		lock_times_add(&stats->hold, duration);
+		if (stats->holder != NULL)
+			lock_holder_add(stats->holder, duration);
+	}
+	LUA_GOBJECT_PROBE1(lock__release, state_lock);
 	g_rec_mutex_unlock(mutex->mutex);
 }
 
+gboolean
+lua_gobject_state_get_single_threaded(gpointer state_lock)
+{
+	LgiStateMutex *mutex = state_lock;
+	return mutex->single_threaded;
+}
+
+void
+lua_gobject_state_set_single_threaded(gpointer state_lock, gboolean enabled)
+{
+	LgiStateMutex *mutex = state_lock;
+	mutex->single_threaded = enabled;
+}
+
+void
+lua_gobject_state_mark(gpointer state_lock, GIBaseInfo *info, gboolean closure)
+{
+	LgiStateMutex *mutex = state_lock;
+	LockStats *stats = mutex->stats;
+	if (stats != NULL && mutex->depth == 1 && info != NULL)
+		stats->holder = lock_holder_get(stats, info, closure);
+}
+
+gint64
+lua_gobject_state_hold_start(gpointer state_lock)
+{
+	LgiStateMutex *mutex = state_lock;
+	return mutex->stats != NULL ? g_get_monotonic_time() : 0;
+}
+
+void
+lua_gobject_state_held(gpointer state_lock, GIBaseInfo *info, gint64 start)
+{
+	LgiStateMutex *mutex = state_lock;
+	LockStats *stats = mutex->stats;
+	if (stats != NULL && start != 0 && info != NULL)
+		lock_holder_add(lock_holder_get(stats, info, FALSE),
+			g_get_monotonic_time() - start);
+}
+
 static const char* log_levels[] = {
 	"ERROR", "CRITICAL", "WARNING", "MESSAGE", "INFO", "DEBUG", "???", NULL
 };
@@ -379,6 +583,265 @@ core_yield(lua_State *L)
 	return 0;
 }
 
+static void
+stats_push_times(lua_State *L, LockTimes *times, const char *name)
+{
+	int i, n = 0;
+	lua_createtable(L, 0, 3);
+	lua_pushnumber(L, times->total);
+	lua_setfield(L, -2, "total");
+	lua_pushnumber(L, times->max);
+	lua_setfield(L, -2, "max");
+
+	/* Histogram contains only nonempty buckets, as pairs of upper limit and count. */
+	lua_newtable(L);
+	for (i = 0; i < LOCK_HISTOGRAM_SIZE; i++)
+		if (times->histogram[i] > 0) {
+			lua_createtable(L, 0, 2);
+			if (i < LOCK_HISTOGRAM_SIZE - 1) {
+				lua_pushnumber(L, (lua_Number) (G_GINT64_CONSTANT(1) << i));
+				lua_setfield(L, -2, "below");
+			}
+			lua_pushnumber(L, (lua_Number) times->histogram[i]);
+			lua_setfield(L, -2, "count");
+			lua_rawseti(L, -2, ++n);
+		}
+	lua_setfield(L, -2, "histogram");
+	lua_setfield(L, -2, name);
+}
+
+static gint
+stats_compare_holders(gconstpointer a, gconstpointer b)
+{
+	const LockHolder *ha = *(LockHolder **) a, *hb = *(LockHolder **) b;
+	return ha->total < hb->total ? 1 : (ha->total > hb->total ? -1 : 0);
+}
+
+/* Process-wide allocation accounting, per category: number of allocations, number of releases and live bytes. */
+static struct {
+	gssize allocs, frees, bytes;
+} alloc_counters[LUA_GOBJECT_ALLOC_LAST];
+
+static const char *const alloc_names[LUA_GOBJECT_ALLOC_LAST] = {
+	"callable", "closure", "guard", "record_embedded", "record", "object",
+	"gi_info", "array",
+};
+
+void
+lua_gobject_alloc_account(LuaGObjectAlloc category, gssize size)
+{
+	g_atomic_pointer_add(size >= 0 ? &alloc_counters[category].allocs
+		: &alloc_counters[category].frees, 1);
+	g_atomic_pointer_add(&alloc_counters[category].bytes, size);
+}
+
+static void
+stats_push_allocs(lua_State *L)
+{
+	int i;
+	lua_createtable(L, 0, LUA_GOBJECT_ALLOC_LAST);
+	for (i = 0; i < LUA_GOBJECT_ALLOC_LAST; i++) {
+		gssize allocs = (gssize) g_atomic_pointer_get(&alloc_counters[i].allocs);
+		gssize frees = (gssize) g_atomic_pointer_get(&alloc_counters[i].frees);
+		lua_createtable(L, 0, 3);
+		lua_pushnumber(L, (lua_Number) allocs);
+		lua_setfield(L, -2, "allocs");
+		lua_pushnumber(L, (lua_Number) (allocs - frees));
+		lua_setfield(L, -2, "live");
+		lua_pushnumber(L, (lua_Number)
+			(gssize) g_atomic_pointer_get(&alloc_counters[i].bytes));
+		lua_setfield(L, -2, "bytes");
+		lua_setfield(L, -2, alloc_names[i]);
+	}
+	lua_setfield(L, -2, "alloc");
+}
+
+/* Lua prototype: ns = core.clock()
+ Returns monotonic time in nanoseconds. */
+static int
+core_clock(lua_State *L)
+{
+	lua_pushnumber(L, (lua_Number) lua_gobject_clock_ns());
+	return 1;
+}
+
+/* Lua prototype: stats = core.stats()
+ Returns table with runtime statistics.  Field 'alloc' contains allocation counts of the whole process by category.  Field 'lock' is present only when lock instrumentation is enabled; all times are in microseconds. */
+static int
+core_stats(lua_State *L)
+{
+	LgiStateMutex *mutex = lua_gobject_state_get_lock(L);
+	LockStats *stats = mutex->stats;
+
+	lua_newtable(L);
+	stats_push_allocs(L);
+	if (stats != NULL) {
+		GPtrArray *holders = g_ptr_array_new();
+		GHashTableIter iter;
+		gpointer holder;
+		guint i;
+
+		lua_newtable(L);
+		lua_pushnumber(L, (lua_Number) stats->acquisitions);
+		lua_setfield(L, -2, "acquisitions");
+		lua_pushnumber(L, (lua_Number) stats->contended);
+		lua_setfield(L, -2, "contended");
+		stats_push_times(L, &stats->wait, "wait");
+		stats_push_times(L, &stats->hold, "hold");
+
+		/* Report callables and closures which held the lock for the longest total time. */
+		for (i = 0; i < 2; i++) {
+			g_hash_table_iter_init(&iter, stats->holders[i]);
+			while (g_hash_table_iter_next(&iter, NULL, &holder))
+				g_ptr_array_add(holders, holder);
+		}
+		g_ptr_array_sort(holders, stats_compare_holders);
+		lua_newtable(L);
+		for (i = 0; i < holders->len && i < LOCK_TOP_HOLDERS; i++) {
+			LockHolder *h = g_ptr_array_index(holders, i);
+			lua_createtable(L, 0, 5);
+			lua_concat(L, lua_gobject_type_get_name(L, h->info));
+			lua_setfield(L, -2, "name");
+			lua_pushstring(L, h->closure ? "closure" : "callable");
+			lua_setfield(L, -2, "kind");
+			lua_pushnumber(L, (lua_Number) h->count);
+			lua_setfield(L, -2, "count");
+			lua_pushnumber(L, h->total);
+			lua_setfield(L, -2, "total");
+			lua_pushnumber(L, h->max);
+			lua_setfield(L, -2, "max");
+			lua_rawseti(L, -2, i + 1);
+		}
+		lua_setfield(L, -2, "holders");
+		g_ptr_array_free(holders, TRUE);
+		lua_setfield(L, -2, "lock");
+	}
+	return 1;
+}
+
+void
+lua_gobject_census_add(lua_State *L, int census, const char *name, gsize size)
+{
+	luaL_checkstack(L, 3, "");
+	lua_getfield(L, census, name);
+	if (lua_isnil(L, -1)) {
+		lua_pop(L, 1);
+		lua_createtable(L, 0, 2);
+		lua_pushvalue(L, -1);
+		lua_setfield(L, census, name);
+	}
+	lua_getfield(L, -1, "count");
+	lua_pushnumber(L, lua_tonumber(L, -1) + 1);
+	lua_setfield(L, -3, "count");
+	lua_getfield(L, -2, "size");
+	lua_pushnumber(L, lua_tonumber(L, -1) + size);
+	lua_setfield(L, -4, "size");
+	lua_pop(L, 3);
+}
+
+/* Stores difference of entries in 'field' of census at index 'current' against census at index 'previous', keeping only changed entries. */
+static void
+census_diff(lua_State *L, int current, int previous, const char *field)
+{
+	int diff, pass, source;
+	lua_newtable(L);
+	diff = lua_gettop(L);
+	lua_getfield(L, current, field);
+	lua_getfield(L, previous, field);
+	luaL_argcheck(L, lua_istable(L, -1), 1, "census expected");
+	for (pass = 0; pass < 2; pass++) {
+		/* First pass walks current entries, second previous entries missing in the current census. */
+		source = diff + 1 + pass;
+		lua_pushnil(L);
+		while (lua_next(L, source)) {
+			lua_Number count, size, sign = pass ? -1 : 1;
+			lua_pushvalue(L, -2);
+			lua_rawget(L, diff + 2 - pass);
+			if (pass && !lua_isnil(L, -1)) {
+				lua_pop(L, 2);
+				continue;
+			}
+			lua_getfield(L, -2, "count");
+			lua_getfield(L, -3, "size");
+			count = sign * lua_tonumber(L, -2);
+			size = sign * lua_tonumber(L, -1);
+			lua_pop(L, 2);
+			if (!pass && lua_istable(L, -1)) {
+				lua_getfield(L, -1, "count");
+				lua_getfield(L, -2, "size");
+				count -= lua_tonumber(L, -2);
+				size -= lua_tonumber(L, -1);
+				lua_pop(L, 2);
+			}
+			lua_pop(L, 2);
+			if (count != 0 || size != 0) {
+				lua_pushvalue(L, -1);
+				lua_createtable(L, 0, 2);
+				lua_pushnumber(L, count);
+				lua_setfield(L, -2, "count");
+				lua_pushnumber(L, size);
+				lua_setfield(L, -2, "size");
+				lua_rawset(L, diff);
+			}
+		}
+	}
+	lua_pop(L, 2);
+	lua_setfield(L, current, field);
+}
+
+/* Lua prototype: census = core.census([previous])
+ Counts live proxies of this state: 'objects', 'records' and 'closures' tables map type names to { count, size } with estimated native sizes; 'refs' is number of GObject references held by proxies and 'parents' number of nested records keeping their parents alive.  When previous census is given, returns only differences against it. */
+static int
+core_census(lua_State *L)
+{
+	static const char *const sections[] = { "objects", "records", "closures" };
+	int result, refs, parents;
+	unsigned i;
+
+	lua_settop(L, 1);
+	lua_createtable(L, 0, 5);
+	result = lua_gettop(L);
+	lua_newtable(L);
+	refs = lua_gobject_object_census(L, result + 1);
+	lua_setfield(L, result, "objects");
+	lua_newtable(L);
+	parents = lua_gobject_record_census(L, result + 1);
+	lua_setfield(L, result, "records");
+	lua_newtable(L);
+	lua_gobject_closure_census(L, result + 1);
+	lua_setfield(L, result, "closures");
+
+	if (!lua_isnil(L, 1)) {
+		luaL_checktype(L, 1, LUA_TTABLE);
+		for (i = 0; i < G_N_ELEMENTS(sections); i++)
+			census_diff(L, result, 1, sections[i]);
+		lua_getfield(L, 1, "refs");
+		refs -= lua_tointeger(L, -1);
+		lua_getfield(L, 1, "parents");
+		parents -= lua_tointeger(L, -1);
+		lua_pop(L, 2);
+	}
+	lua_pushinteger(L, refs);
+	lua_setfield(L, result, "refs");
+	lua_pushinteger(L, parents);
+	lua_setfield(L, result, "parents");
+	return 1;
+}
+
+/* Lua prototype: core.stats_reset([lock])
+ Resets all statistics.  If lock is given, it also turns lock instrumentation on or off. */
+static int
+core_stats_reset(lua_State *L)
+{
+	LgiStateMutex *mutex = lua_gobject_state_get_lock(L);
+	gboolean enable = lua_isnoneornil(L, 1)
+		? mutex->stats != NULL : lua_toboolean(L, 1);
+	LockStats *stats = mutex->stats;
+	g_atomic_pointer_set(&mutex->stats, enable ? lock_stats_new() : NULL);
+	lock_stats_free(stats);
+	return 0;
+}
+
 static void
 package_lock_enter(void)
 {
@@ -574,6 +1037,10 @@ static const struct luaL_Reg lua_gobject_reg[] = {
 	{ "module", core_module },
 	{ "upcase", core_upcase },
 	{ "downcase", core_downcase },
+	{ "stats", core_stats },
+	{ "stats_reset", core_stats_reset },
+	{ "census", core_census },
+	{ "clock", core_clock },
 	{ NULL, NULL }
 };
 
@@ -642,11 +1109,60 @@ set_resident(lua_State *L)
 	}
 }
 
+#ifdef LUA_GOBJECT_EMBED
+/* package.preload loader of an embedded module, upvalue 1 is its LuaGObjectEmbedded entry. */
+static int
+embedded_load(lua_State *L)
+{
+	const LuaGObjectEmbedded *module = lua_touserdata(L, lua_upvalueindex(1));
+	if (luaL_loadbuffer(L, (const char *) module->code, module->size,
+			module->name) != 0)
+		return luaL_error(L, "embedded module '%s': %s", module->name,
+			lua_tostring(L, -1));
+	lua_pushstring(L, module->name);
+	lua_call(L, 1, 1);
+	return 1;
+}
+
+/* Registers modules embedded in the core into package.preload, unless they are already loaded or preloaded.  Setting LUAGOBJECT_NO_EMBEDDED makes all modules load from package.path again. */
+static void
+embedded_register(lua_State *L)
+{
+	const LuaGObjectEmbedded *module;
+	if (g_getenv("LUAGOBJECT_NO_EMBEDDED") != NULL)
+		return;
+
+	lua_getfield(L, LUA_REGISTRYINDEX, "_LOADED");
+	lua_getfield(L, -1, "package");
+	if (!lua_istable(L, -1)) {
+		lua_pop(L, 2);
+		return;
+	}
+	lua_getfield(L, -1, "preload");
+	if (!lua_istable(L, -1)) {
+		lua_pop(L, 3);
+		return;
+	}
+	for (module = lua_gobject_embedded; module->name != NULL; module++) {
+		lua_getfield(L, -3, module->name);
+		lua_getfield(L, -2, module->name);
+		if (lua_isnil(L, -1) && lua_isnil(L, -2)) {
+			lua_pushlightuserdata(L, (gpointer) module);
+			lua_pushcclosure(L, embedded_load, 1);
+			lua_setfield(L, -4, module->name);
+		}
+		lua_pop(L, 2);
+	}
+	lua_pop(L, 3);
+}
+#endif
+
 G_MODULE_EXPORT int
 luaopen_LuaGObject_lua_gobject_core(lua_State* L)
 {
 	LgiStateMutex *mutex;
 	gint state_id;
+	gint64 open_start = lua_gobject_clock_ns();
 
 	/* Try to make itself resident. This is needed because this dynamic module is 'statically' linked with glib/gobject, and these libraries are not designed to be unloaded. Once they are unloaded, they cannot be safely loaded again into the same process. To avoid problems when repeatedly opening and closing lua_States and loading lua_gobject into them, we try to make the whole 'core' module resident. */
 	set_resident(L);
@@ -686,6 +1202,10 @@ luaopen_LuaGObject_lua_gobject_core(lua_State* L)
 	lua_pushlightuserdata(L, &call_mutex);
 	mutex = lua_newuserdata(L, sizeof(*mutex));
 	mutex->mutex = &mutex->state_mutex;
+	mutex->depth = 1;
+	mutex->single_threaded = FALSE;
+	mutex->stats = g_getenv("LUAGOBJECT_LOCK_STATS") != NULL
+		? lock_stats_new() : NULL;
 	g_rec_mutex_init(&mutex->state_mutex);
 	g_rec_mutex_lock(&mutex->state_mutex);
 	lua_pushlightuserdata(L, &call_mutex_mt);
@@ -724,6 +1244,22 @@ luaopen_LuaGObject_lua_gobject_core(lua_State* L)
 	lua_gobject_record_init(L);
 	lua_gobject_object_init(L);
 	lua_gobject_callable_init(L);
+	lua_gobject_timerwheel_init(L);
+	lua_gobject_worker_init(L);
+
+#ifdef LUA_GOBJECT_EMBED
+	embedded_register(L);
+#endif
+
+	/* When startup tracing is requested, remember when and how long the core was being opened. */
+	if (g_getenv("LUAGOBJECT_TRACE_STARTUP") != NULL) {
+		lua_createtable(L, 0, 2);
+		lua_pushnumber(L, (lua_Number) open_start);
+		lua_setfield(L, -2, "start");
+		lua_pushnumber(L, (lua_Number) (lua_gobject_clock_ns() - open_start));
+		lua_setfield(L, -2, "open");
+		lua_setfield(L, -2, "startup");
+	}
 
 	/* Return registration table. */
 	return 1;
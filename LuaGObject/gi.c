@@ -23,7 +23,10 @@ lua_gobject_gi_get_repository(void)
 	return repository;
 }
 
-/* Creates new instance of info from given GIBaseInfo pointer. */
+/* Address is lightuserdata of the table in the registry with weak values, mapping GIBaseInfo pointers to their wrappers. */
+static int info_cache;
+
+/* Creates new instance of info from given GIBaseInfo pointer, or returns already existing one, consuming the reference. */
 int
 lua_gobject_gi_info_new(lua_State *L, GIBaseInfo *info)
 {
@@ -32,10 +35,28 @@ lua_gobject_gi_info_new(lua_State *L, GIBaseInfo *info)
 
 		g_assert(GI_IS_BASE_INFO(info));
 
+		luaL_checkstack(L, 4, "");
+		lua_pushlightuserdata(L, &info_cache);
+		lua_rawget(L, LUA_REGISTRYINDEX);
+		lua_pushlightuserdata(L, info);
+		lua_rawget(L, -2);
+		if (!lua_isnil(L, -1)) {
+			/* Reuse the wrapper, which holds its own reference. */
+			lua_replace(L, -2);
+			gi_base_info_unref(info);
+			return 1;
+		}
+		lua_pop(L, 1);
+
 		ud_info = lua_newuserdata(L, sizeof(info));
+		lua_gobject_alloc_account(LUA_GOBJECT_ALLOC_GI_INFO, sizeof(info));
 		*ud_info = info;
 		luaL_getmetatable(L, LUA_GOBJECT_GI_INFO);
 		lua_setmetatable(L, -2);
+		lua_pushlightuserdata(L, info);
+		lua_pushvalue(L, -2);
+		lua_rawset(L, -4);
+		lua_replace(L, -2);
 	}
 	else
 	lua_pushnil(L);
@@ -43,6 +64,41 @@ lua_gobject_gi_info_new(lua_State *L, GIBaseInfo *info)
 	return 1;
 }
 
+/* Address is lightuserdata of the table in the registry with weak keys, mapping info and infos wrappers to the tables of their already computed parts, so that repeated accesses to them return the same wrappers. */
+static int info_memo;
+
+/* Pushes the table of already computed parts of the userdata at given (absolute) index. */
+static void
+info_memo_get(lua_State *L, int narg)
+{
+	lua_pushlightuserdata(L, &info_memo);
+	lua_rawget(L, LUA_REGISTRYINDEX);
+	lua_pushvalue(L, narg);
+	lua_rawget(L, -2);
+	if (lua_isnil(L, -1)) {
+		lua_pop(L, 1);
+		lua_newtable(L);
+		lua_pushvalue(L, narg);
+		lua_pushvalue(L, -2);
+		lua_rawset(L, -4);
+	}
+	lua_replace(L, -2);
+}
+
+/* gi_typelib_symbol() opens the libraries of the typelib on first use without any locking; serialize it, because callables can be resolved also by the background thread, see core.callable.eager(). */
+G_LOCK_DEFINE_STATIC(typelib_symbol);
+
+gboolean
+lua_gobject_gi_typelib_symbol(GITypelib *typelib, const gchar *symbol,
+	gpointer *address)
+{
+	gboolean found;
+	G_LOCK(typelib_symbol);
+	found = gi_typelib_symbol(typelib, symbol, address);
+	G_UNLOCK(typelib_symbol);
+	return found;
+}
+
 gpointer
 lua_gobject_gi_load_function(lua_State *L, int typetable, const char *name)
 {
@@ -53,7 +109,7 @@ lua_gobject_gi_load_function(lua_State *L, int typetable, const char *name)
 	lua_getfield(L, typetable, name);
 	info = lua_gobject_udata_test(L, -1, LUA_GOBJECT_GI_INFO);
 	if (info && GI_IS_FUNCTION_INFO(*info))
-		gi_typelib_symbol(gi_base_info_get_typelib(*info),
+		lua_gobject_gi_typelib_symbol(gi_base_info_get_typelib(*info),
 			gi_function_info_get_symbol(GI_FUNCTION_INFO(*info)),
 			&symbol);
 	else if (lua_islightuserdata(L, -1))
@@ -87,7 +143,15 @@ infos_index(lua_State *L)
 	if (lua_type(L, 2) == LUA_TNUMBER) {
 		n = lua_tointeger(L, 2) - 1;
 		luaL_argcheck(L, n >= 0 && n < infos->count, 2, "out of bounds");
-		return lua_gobject_gi_info_new(L, infos->item_get(infos->info, n));
+		info_memo_get(L, 1);
+		lua_rawgeti(L, -1, n + 1);
+		if (lua_isnil(L, -1)) {
+			lua_pop(L, 1);
+			lua_gobject_gi_info_new(L, infos->item_get(infos->info, n));
+			lua_pushvalue(L, -1);
+			lua_rawseti(L, -3, n + 1);
+		}
+		return 1;
 	} else {
 		const gchar *name = luaL_checkstring(L, 2);
 		for (n = 0; n < infos->count; n++) {
@@ -128,6 +192,26 @@ infos_new(lua_State *L, GIBaseInfo *info, gint count, InfosItemGet item_get)
 	return 1;
 }
 
+/* Lua API: names = core.gi.names(infos)
+Returns table mapping names of all infos in the group to their indices, built in single pass without creating wrappers of the individual infos. */
+static int
+gi_names(lua_State *L)
+{
+	Infos *infos = luaL_checkudata(L, 1, LUA_GOBJECT_GI_INFOS);
+	gint n;
+	lua_createtable(L, 0, infos->count);
+	for (n = 0; n < infos->count; n++) {
+		GIBaseInfo *info = infos->item_get(infos->info, n);
+		const gchar *name = gi_base_info_get_name(info);
+		if (name != NULL) {
+			lua_pushinteger(L, n + 1);
+			lua_setfield(L, -2, name);
+		}
+		gi_base_info_unref(info);
+	}
+	return 1;
+}
+
 static const luaL_Reg gi_infos_reg[] = {
 	{ "__gc", infos_gc },
 	{ "__len", infos_len },
@@ -151,27 +235,151 @@ info_push_transfer(lua_State *L, GITransfer transfer)
 	return 0;
 }
 
+/* All properties of gi info, dispatched by info_index() through their ids.  Properties with the second argument set hold infos of parts of the info and are computed only once for each info wrapper, so that repeated accesses return the same wrappers. */
+#define INFO_PROPS \
+	P(type, 0) P(is_arg, 0) P(is_callable, 0) P(is_function, 0) \
+	P(is_signal, 0) P(is_vfunc, 0) P(is_constant, 0) P(is_field, 0) \
+	P(is_property, 0) P(is_registered_type, 0) P(is_enum, 0) \
+	P(is_interface, 0) P(is_object, 0) P(is_struct, 0) P(is_union, 0) \
+	P(is_type, 0) P(is_value, 0) P(name, 0) P(namespace, 0) \
+	P(fullname, 0) P(deprecated, 0) P(container, 0) P(typeinfo, 1) \
+	P(gtype, 0) P(is_gtype_struct, 0) P(size, 0) P(fields, 1) \
+	P(methods, 1) P(type_struct, 0) P(prerequisites, 1) P(vfuncs, 1) \
+	P(constants, 1) P(properties, 1) P(signals, 1) P(parent, 0) \
+	P(interfaces, 1) P(return_type, 1) P(return_transfer, 0) P(args, 1) \
+	P(flags, 0) P(storage, 0) P(values, 1) P(error_domain, 0) P(value, 0) \
+	P(direction, 0) P(transfer, 0) P(optional, 0) P(offset, 0) P(tag, 0) \
+	P(is_basic, 0) P(params, 0) P(interface, 0) P(array_type, 0) \
+	P(is_zero_terminated, 0) P(array_length, 0) P(fixed_size, 0) \
+	P(is_pointer, 0)
+
+enum {
+#define P(n, m) INFO_PROP_ ## n,
+	INFO_PROPS
+#undef P
+	INFO_PROP_COUNT
+};
+
+static const char *const info_prop_names[] = {
+#define P(n, m) #n,
+	INFO_PROPS
+#undef P
+};
+
+static const guint8 info_prop_memo[] = {
+#define P(n, m) m,
+	INFO_PROPS
+#undef P
+};
+
+/* Pushes value of the property of type info with given id. */
 static int
-info_index(lua_State *L)
+info_get_type(lua_State *L, GITypeInfo *info, int prop)
 {
-	GIBaseInfo **info = luaL_checkudata(L, 1, LUA_GOBJECT_GI_INFO);
-	const gchar *prop = luaL_checkstring(L, 2);
+	GITypeTag tag = gi_type_info_get_tag(info);
+	switch (prop) {
+	case INFO_PROP_tag:
+		lua_pushstring(L, gi_type_tag_to_string(tag));
+		return 1;
+
+	case INFO_PROP_is_basic:
+		lua_pushboolean(L, GI_TYPE_TAG_IS_BASIC(tag));
+		return 1;
+
+	case INFO_PROP_params:
+		if (tag == GI_TYPE_TAG_ARRAY || tag == GI_TYPE_TAG_GLIST
+				|| tag == GI_TYPE_TAG_GSLIST
+				|| tag == GI_TYPE_TAG_GHASH) {
+			lua_newtable(L);
+			lua_gobject_gi_info_new(L,
+				GI_BASE_INFO(gi_type_info_get_param_type(info, 0)));
+			lua_rawseti(L, -2, 1);
+			if (tag == GI_TYPE_TAG_GHASH) {
+				lua_gobject_gi_info_new(L, GI_BASE_INFO(
+						gi_type_info_get_param_type(info, 1)));
+				lua_rawseti(L, -2, 2);
+			}
+			return 1;
+		}
+		break;
+
+	case INFO_PROP_interface:
+		if (tag == GI_TYPE_TAG_INTERFACE)
+			return lua_gobject_gi_info_new(L,
+				gi_type_info_get_interface(info));
+		break;
+
+	case INFO_PROP_array_type:
+		if (tag == GI_TYPE_TAG_ARRAY) {
+			switch(gi_type_info_get_array_type(info)) {
+#define H(n1, n2) \
+			case GI_ARRAY_TYPE_ ## n1: \
+				lua_pushstring(L, #n2); \
+				return 1;
+
+			H(C, c)
+			H(ARRAY, array)
+			H(PTR_ARRAY, ptr_array)
+			H(BYTE_ARRAY, byte_array)
+#undef H
+			default:
+				g_assert_not_reached();
+			}
+		}
+		break;
+
+	case INFO_PROP_is_zero_terminated:
+		if (tag == GI_TYPE_TAG_ARRAY) {
+			lua_pushboolean(L, gi_type_info_is_zero_terminated(info));
+			return 1;
+		}
+		break;
+
+	case INFO_PROP_array_length: {
+		guint len;
+		if (gi_type_info_get_array_length_index(info, &len)) {
+			lua_pushinteger(L, len);
+			return 1;
+		}
+		break;
+	}
+
+	case INFO_PROP_fixed_size: {
+		gsize size;
+		if (gi_type_info_get_array_fixed_size(info, &size)) {
+			lua_pushinteger(L, size);
+			return 1;
+		}
+		break;
+	}
+
+	case INFO_PROP_is_pointer:
+		lua_pushboolean(L, gi_type_info_is_pointer(info));
+		return 1;
+	}
+
+	lua_pushnil(L);
+	return 1;
+}
 
+/* Pushes value of the property with given id. */
+static int
+info_get(lua_State *L, GIBaseInfo *info, int prop)
+{
 #define INFOS(n1, n2) \
-	else if (strcmp(prop, #n2 "s") == 0) \
-	return infos_new(L, GI_BASE_INFO(*info), \
-		gi_ ## n1 ## _info_get_n_ ## n2 ## s((gpointer)*info), \
-		(InfosItemGet) gi_ ## n1 ## _info_get_ ## n2);
+	return infos_new(L, info, \
+		gi_ ## n1 ## _info_get_n_ ## n2 ## s((gpointer) info), \
+		(InfosItemGet) gi_ ## n1 ## _info_get_ ## n2)
 
 #define INFOS2(n1, n2, n3) \
-	else if (strcmp(prop, #n3) == 0) \
-	return infos_new(L, GI_BASE_INFO(*info), \
-		gi_ ## n1 ## _info_get_n_ ## n3((gpointer)*info), \
-		(InfosItemGet) gi_ ## n1 ## _info_get_ ## n2);
+	return infos_new(L, info, \
+		gi_ ## n1 ## _info_get_n_ ## n3((gpointer) info), \
+		(InfosItemGet) gi_ ## n1 ## _info_get_ ## n2)
 
-	if (strcmp(prop, "type") == 0) {
+	switch (prop) {
+	case INFO_PROP_type:
 #define H(n1, n2) \
-		else if (GI_IS_ ## n1 ## _INFO(*info)) { \
+		else if (GI_IS_ ## n1 ## _INFO(info)) { \
 			lua_pushstring(L, #n2); \
 			return 1; \
 		}
@@ -196,13 +404,12 @@ info_index(lua_State *L)
 		H(UNRESOLVED, unresolved)
 		else g_assert_not_reached();
 #undef H
-	}
+		break;
 
 #define H(n1, n2) \
-	if (strcmp(prop, "is_" #n2) == 0) { \
-		lua_pushboolean(L, GI_IS_ ## n1 ## _INFO(*info)); \
-		return 1; \
-	}
+	case INFO_PROP_is_ ## n2: \
+		lua_pushboolean(L, GI_IS_ ## n1 ## _INFO(info)); \
+		return 1;
 	H(ARG, arg)
 	H(CALLABLE, callable)
 	H(FUNCTION, function)
@@ -218,173 +425,258 @@ info_index(lua_State *L)
 	H(STRUCT, struct)
 	H(UNION, union)
 	H(TYPE, type)
-	H(VALUE, value);
+	H(VALUE, value)
 #undef H
 
-	if (!GI_IS_TYPE_INFO(*info)) {
-		if (strcmp(prop, "name") == 0) {
-			lua_pushstring(L, gi_base_info_get_name(*info));
+	case INFO_PROP_name:
+		if (!GI_IS_TYPE_INFO(info)) {
+			lua_pushstring(L, gi_base_info_get_name(info));
 			return 1;
-		} else if (strcmp(prop, "namespace") == 0) {
-			lua_pushstring(L, gi_base_info_get_namespace(*info));
+		}
+		break;
+
+	case INFO_PROP_namespace:
+		if (!GI_IS_TYPE_INFO(info)) {
+			lua_pushstring(L, gi_base_info_get_namespace(info));
 			return 1;
 		}
-	}
+		break;
 
-	if (strcmp(prop, "fullname") == 0) {
-		lua_concat(L, lua_gobject_type_get_name(L, *info));
+	case INFO_PROP_fullname:
+		lua_concat(L, lua_gobject_type_get_name(L, info));
 		return 1;
-	}
 
-	if (strcmp(prop, "deprecated") == 0) {
-		lua_pushboolean(L, gi_base_info_is_deprecated(*info));
+	case INFO_PROP_deprecated:
+		lua_pushboolean(L, gi_base_info_is_deprecated(info));
 		return 1;
-	} else if (strcmp(prop, "container") == 0) {
-		GIBaseInfo *container = gi_base_info_get_container(*info);
+
+	case INFO_PROP_container: {
+		GIBaseInfo *container = gi_base_info_get_container(info);
 		if (container)
 			gi_base_info_ref(container);
 		return lua_gobject_gi_info_new(L, container);
-	} else if (strcmp(prop, "typeinfo") == 0) {
+	}
+
+	case INFO_PROP_typeinfo: {
 		GITypeInfo *ti = NULL;
-		if (GI_IS_ARG_INFO(*info))
-		ti = gi_arg_info_get_type_info(GI_ARG_INFO(*info));
-		else if (GI_IS_CONSTANT_INFO(*info))
-		ti = gi_constant_info_get_type_info(GI_CONSTANT_INFO(*info));
-		else if (GI_IS_PROPERTY_INFO(*info))
-		ti = gi_property_info_get_type_info(GI_PROPERTY_INFO(*info));
-		else if (GI_IS_FIELD_INFO(*info))
-		ti = gi_field_info_get_type_info(GI_FIELD_INFO(*info));
+		if (GI_IS_ARG_INFO(info))
+		ti = gi_arg_info_get_type_info(GI_ARG_INFO(info));
+		else if (GI_IS_CONSTANT_INFO(info))
+		ti = gi_constant_info_get_type_info(GI_CONSTANT_INFO(info));
+		else if (GI_IS_PROPERTY_INFO(info))
+		ti = gi_property_info_get_type_info(GI_PROPERTY_INFO(info));
+		else if (GI_IS_FIELD_INFO(info))
+		ti = gi_field_info_get_type_info(GI_FIELD_INFO(info));
 
 		if (ti)
 			return lua_gobject_gi_info_new(L, GI_BASE_INFO(ti));
+		break;
 	}
 
-	if (GI_IS_REGISTERED_TYPE_INFO(*info)) {
-		if (strcmp(prop, "gtype") == 0) {
+	case INFO_PROP_gtype:
+		if (GI_IS_REGISTERED_TYPE_INFO(info)) {
 			GType gtype = gi_registered_type_info_get_g_type(
-				GI_REGISTERED_TYPE_INFO(*info));
+				GI_REGISTERED_TYPE_INFO(info));
 			if (gtype != G_TYPE_NONE)
 				lua_pushlightuserdata(L,(void *) gtype);
 			else
 				lua_pushnil(L);
 			return 1;
-		} else if (GI_IS_STRUCT_INFO(*info)) {
-			if (strcmp(prop, "is_gtype_struct") == 0) {
-				lua_pushboolean(L,
-					gi_struct_info_is_gtype_struct(GI_STRUCT_INFO(*info)));
-				return 1;
-			} else if (strcmp(prop, "size") == 0) {
-				lua_pushinteger(L,
-					gi_struct_info_get_size(GI_STRUCT_INFO(*info)));
-				return 1;
-			}
-			INFOS(struct, field)
+		}
+		break;
+
+	case INFO_PROP_is_gtype_struct:
+		if (GI_IS_STRUCT_INFO(info)) {
+			lua_pushboolean(L,
+				gi_struct_info_is_gtype_struct(GI_STRUCT_INFO(info)));
+			return 1;
+		}
+		break;
+
+	case INFO_PROP_size:
+		if (GI_IS_STRUCT_INFO(info)) {
+			lua_pushinteger(L, gi_struct_info_get_size(GI_STRUCT_INFO(info)));
+			return 1;
+		} else if (GI_IS_UNION_INFO(info)) {
+			lua_pushinteger(L, gi_union_info_get_size(GI_UNION_INFO(info)));
+			return 1;
+		} else if (GI_IS_FIELD_INFO(info)) {
+			lua_pushinteger(L, gi_field_info_get_size(GI_FIELD_INFO(info)));
+			return 1;
+		}
+		break;
+
+	case INFO_PROP_fields:
+		if (GI_IS_STRUCT_INFO(info))
+			INFOS(struct, field);
+		else if (GI_IS_UNION_INFO(info))
+			INFOS(union, field);
+		else if (GI_IS_OBJECT_INFO(info))
+			INFOS(object, field);
+		break;
+
+	case INFO_PROP_methods:
+		if (GI_IS_STRUCT_INFO(info))
 			INFOS(struct, method);
-		} else if (GI_IS_UNION_INFO(*info)) {
-			if (strcmp(prop, "size") == 0) {
-				lua_pushinteger(L,
-					gi_union_info_get_size(GI_UNION_INFO(*info)));
-				return 1;
-			}
-			INFOS(union, field)
+		else if (GI_IS_UNION_INFO(info))
 			INFOS(union, method);
-		} else if (GI_IS_INTERFACE_INFO(*info)) {
-			if (strcmp(prop, "type_struct") == 0)
-				return lua_gobject_gi_info_new(L,
-					GI_BASE_INFO(gi_interface_info_get_iface_struct(
-						GI_INTERFACE_INFO(*info))));
-			INFOS(interface, prerequisite)
-			INFOS(interface, vfunc)
-			INFOS(interface, method)
-			INFOS(interface, constant)
-			INFOS2(interface, property, properties)
+		else if (GI_IS_INTERFACE_INFO(info))
+			INFOS(interface, method);
+		else if (GI_IS_OBJECT_INFO(info))
+			INFOS(object, method);
+#if GLIB_CHECK_VERSION(2, 30, 0)
+		else if (GI_IS_ENUM_INFO(info) || GI_IS_FLAGS_INFO(info))
+			INFOS(enum, method);
+#endif
+		break;
+
+	case INFO_PROP_type_struct:
+		if (GI_IS_INTERFACE_INFO(info))
+			return lua_gobject_gi_info_new(L,
+				GI_BASE_INFO(gi_interface_info_get_iface_struct(
+					GI_INTERFACE_INFO(info))));
+		else if (GI_IS_OBJECT_INFO(info))
+			return lua_gobject_gi_info_new(L, GI_BASE_INFO(
+					gi_object_info_get_class_struct(
+						GI_OBJECT_INFO(info))));
+		break;
+
+	case INFO_PROP_prerequisites:
+		if (GI_IS_INTERFACE_INFO(info))
+			INFOS(interface, prerequisite);
+		break;
+
+	case INFO_PROP_vfuncs:
+		if (GI_IS_INTERFACE_INFO(info))
+			INFOS(interface, vfunc);
+		else if (GI_IS_OBJECT_INFO(info))
+			INFOS(object, vfunc);
+		break;
+
+	case INFO_PROP_constants:
+		if (GI_IS_INTERFACE_INFO(info))
+			INFOS(interface, constant);
+		else if (GI_IS_OBJECT_INFO(info))
+			INFOS(object, constant);
+		break;
+
+	case INFO_PROP_properties:
+		if (GI_IS_INTERFACE_INFO(info))
+			INFOS2(interface, property, properties);
+		else if (GI_IS_OBJECT_INFO(info))
+			INFOS2(object, property, properties);
+		break;
+
+	case INFO_PROP_signals:
+		if (GI_IS_INTERFACE_INFO(info))
 			INFOS(interface, signal);
-		} else if (GI_IS_OBJECT_INFO(*info)) {
-			if (strcmp(prop, "parent") == 0)
-				return lua_gobject_gi_info_new(L, GI_BASE_INFO(
-						gi_object_info_get_parent(GI_OBJECT_INFO(*info))));
-			else if (strcmp(prop, "type_struct") == 0)
-				return lua_gobject_gi_info_new(L, GI_BASE_INFO(
-						gi_object_info_get_class_struct(
-							GI_OBJECT_INFO(*info))));
-			INFOS(object, interface)
-			INFOS(object, field)
-			INFOS(object, vfunc)
-			INFOS(object, method)
-			INFOS(object, constant)
-			INFOS2(object, property, properties)
+		else if (GI_IS_OBJECT_INFO(info))
 			INFOS(object, signal);
-		}
-	}
+		break;
+
+	case INFO_PROP_parent:
+		if (GI_IS_OBJECT_INFO(info))
+			return lua_gobject_gi_info_new(L, GI_BASE_INFO(
+					gi_object_info_get_parent(GI_OBJECT_INFO(info))));
+		break;
+
+	case INFO_PROP_interfaces:
+		if (GI_IS_OBJECT_INFO(info))
+			INFOS(object, interface);
+		break;
 
-	if (GI_IS_CALLABLE_INFO(*info)) {
-		if (strcmp(prop, "return_type") == 0)
+	case INFO_PROP_return_type:
+		if (GI_IS_CALLABLE_INFO(info))
 			return lua_gobject_gi_info_new(L, GI_BASE_INFO(
 					gi_callable_info_get_return_type(
-						GI_CALLABLE_INFO(*info))));
-		else if (strcmp(prop, "return_transfer") == 0)
+						GI_CALLABLE_INFO(info))));
+		break;
+
+	case INFO_PROP_return_transfer:
+		if (GI_IS_CALLABLE_INFO(info))
 			return info_push_transfer(L, gi_callable_info_get_caller_owns(
-					GI_CALLABLE_INFO(*info)));
-		INFOS(callable, arg);
-
-		if (GI_IS_SIGNAL_INFO(*info)) {
-			if (strcmp(prop, "flags") == 0) {
-				GSignalFlags flags = gi_signal_info_get_flags(
-					GI_SIGNAL_INFO(*info));
-				lua_newtable(L);
+					GI_CALLABLE_INFO(info)));
+		break;
+
+	case INFO_PROP_args:
+		if (GI_IS_CALLABLE_INFO(info))
+			INFOS(callable, arg);
+		break;
+
+	case INFO_PROP_flags:
+		if (GI_IS_SIGNAL_INFO(info)) {
+			GSignalFlags flags = gi_signal_info_get_flags(
+				GI_SIGNAL_INFO(info));
+			lua_newtable(L);
 #define H(n1, n2) \
-				if ((flags & G_SIGNAL_ ## n1) != 0) { \
-					lua_pushboolean(L, 1); \
-					lua_setfield(L, -2, #n2); \
-				}
-				H(RUN_FIRST, run_first)
-				H(RUN_LAST, run_last)
-				H(RUN_CLEANUP, run_cleanup)
-				H(NO_RECURSE, no_recurse)
-				H(DETAILED, detailed)
-				H(ACTION, action)
-				H(NO_HOOKS, no_hooks);
-#undef H
-				return 1;
+			if ((flags & G_SIGNAL_ ## n1) != 0) { \
+				lua_pushboolean(L, 1); \
+				lua_setfield(L, -2, #n2); \
 			}
-		}
-
-		if (GI_IS_FUNCTION_INFO(*info)) {
-			if (strcmp(prop, "flags") == 0) {
-				GIFunctionInfoFlags flags = gi_function_info_get_flags(
-					GI_FUNCTION_INFO(*info));
-				lua_newtable(L);
-				if (0);
+			H(RUN_FIRST, run_first)
+			H(RUN_LAST, run_last)
+			H(RUN_CLEANUP, run_cleanup)
+			H(NO_RECURSE, no_recurse)
+			H(DETAILED, detailed)
+			H(ACTION, action)
+			H(NO_HOOKS, no_hooks);
+#undef H
+			return 1;
+		} else if (GI_IS_FUNCTION_INFO(info)) {
+			GIFunctionInfoFlags flags = gi_function_info_get_flags(
+				GI_FUNCTION_INFO(info));
+			lua_newtable(L);
+			if (0);
 #define H(n1, n2) \
-				else if ((flags & GI_FUNCTION_ ## n1) != 0)  { \
-					lua_pushboolean(L, 1); \
-					lua_setfield(L, -2, #n2); \
-				}
-				H(IS_METHOD, is_method)
-				H(IS_CONSTRUCTOR, is_constructor)
-				H(IS_GETTER, is_getter)
-				H(IS_SETTER, is_setter)
-				H(WRAPS_VFUNC, wraps_vfunc)
+			else if ((flags & GI_FUNCTION_ ## n1) != 0)  { \
+				lua_pushboolean(L, 1); \
+				lua_setfield(L, -2, #n2); \
+			}
+			H(IS_METHOD, is_method)
+			H(IS_CONSTRUCTOR, is_constructor)
+			H(IS_GETTER, is_getter)
+			H(IS_SETTER, is_setter)
+			H(WRAPS_VFUNC, wraps_vfunc)
 #undef H
-				return 1;
+			return 1;
+		} else if (GI_IS_PROPERTY_INFO(info)) {
+			lua_pushinteger(L,
+				gi_property_info_get_flags(GI_PROPERTY_INFO(info)));
+			return 1;
+		} else if (GI_IS_FIELD_INFO(info)) {
+			GIFieldInfoFlags flags = gi_field_info_get_flags(GI_FIELD_INFO(info));
+			lua_newtable(L);
+			if (0);
+#define H(n1, n2) \
+			else if ((flags & GI_FIELD_ ## n1) != 0)  { \
+				lua_pushboolean(L, 1); \
+				lua_setfield(L, -2, #n2); \
 			}
+			H(IS_READABLE, is_readable)
+			H(IS_WRITABLE, is_writable)
+#undef H
+			return 1;
 		}
-	}
+		break;
 
-	if (GI_IS_ENUM_INFO(*info) || GI_IS_FLAGS_INFO(*info)) {
-		if (strcmp(prop, "storage") == 0) {
+	case INFO_PROP_storage:
+		if (GI_IS_ENUM_INFO(info) || GI_IS_FLAGS_INFO(info)) {
 			GITypeTag tag = gi_enum_info_get_storage_type(
-				GI_ENUM_INFO(*info));
+				GI_ENUM_INFO(info));
 			lua_pushstring(L, gi_type_tag_to_string(tag));
 			return 1;
 		}
-#if GLIB_CHECK_VERSION(2, 30, 0)
-		INFOS(enum, method)
-#endif
-		INFOS(enum, value)
-		else if (strcmp(prop, "error_domain") == 0) {
+		break;
+
+	case INFO_PROP_values:
+		if (GI_IS_ENUM_INFO(info) || GI_IS_FLAGS_INFO(info))
+			INFOS(enum, value);
+		break;
+
+	case INFO_PROP_error_domain:
+		if (GI_IS_ENUM_INFO(info) || GI_IS_FLAGS_INFO(info)) {
 			const gchar *domain = gi_enum_info_get_error_domain(
-				GI_ENUM_INFO(*info));
+				GI_ENUM_INFO(info));
 			if (domain != NULL)
 				lua_pushinteger(L, g_quark_from_string(domain));
 			else
@@ -392,137 +684,58 @@ info_index(lua_State *L)
 
 			return 1;
 		}
-	}
+		break;
 
-	if (GI_IS_VALUE_INFO(*info)) {
-		if (strcmp(prop, "value") == 0) {
-			lua_pushinteger(L, gi_value_info_get_value(GI_VALUE_INFO(*info)));
+	case INFO_PROP_value:
+		if (GI_IS_VALUE_INFO(info)) {
+			lua_pushinteger(L, gi_value_info_get_value(GI_VALUE_INFO(info)));
 			return 1;
 		}
-	}
+		break;
 
-	if (GI_IS_ARG_INFO(*info)) {
-		if (strcmp(prop, "direction") == 0) {
-			GIDirection dir = gi_arg_info_get_direction(GI_ARG_INFO(*info));
+	case INFO_PROP_direction:
+		if (GI_IS_ARG_INFO(info)) {
+			GIDirection dir = gi_arg_info_get_direction(GI_ARG_INFO(info));
 			if (dir == GI_DIRECTION_OUT)
 				lua_pushstring(L,
-					gi_arg_info_is_caller_allocates(GI_ARG_INFO(*info))
+					gi_arg_info_is_caller_allocates(GI_ARG_INFO(info))
 						? "out-caller-alloc" : "out");
 			else
 				lua_pushstring(L, dir == GI_DIRECTION_IN ? "in" : "inout");
 			return 1;
 		}
-		if (strcmp(prop, "transfer") == 0)
-			return info_push_transfer(L,
-				gi_arg_info_get_ownership_transfer(GI_ARG_INFO(*info)));
-		if (strcmp(prop, "optional") == 0) {
-			lua_pushboolean(L, gi_arg_info_is_optional(GI_ARG_INFO(*info))
-				|| gi_arg_info_may_be_null(GI_ARG_INFO(*info)));
-			return 1;
-		}
-	}
+		break;
 
-	if (GI_IS_PROPERTY_INFO(*info)) {
-		if (strcmp(prop, "flags") == 0) {
-			lua_pushinteger(L,
-				gi_property_info_get_flags(GI_PROPERTY_INFO(*info)));
-			return 1;
-		}
-		else if (strcmp(prop, "transfer") == 0)
+	case INFO_PROP_transfer:
+		if (GI_IS_ARG_INFO(info))
+			return info_push_transfer(L,
+				gi_arg_info_get_ownership_transfer(GI_ARG_INFO(info)));
+		else if (GI_IS_PROPERTY_INFO(info))
 			return info_push_transfer(L,
 				gi_property_info_get_ownership_transfer(
-					GI_PROPERTY_INFO(*info)));
-	}
+					GI_PROPERTY_INFO(info)));
+		break;
 
-	if (GI_IS_FIELD_INFO(*info)) {
-		if (strcmp(prop, "flags") == 0) {
-			GIFieldInfoFlags flags = gi_field_info_get_flags(GI_FIELD_INFO(*info));
-			lua_newtable(L);
-			if (0);
-#define H(n1, n2) \
-				else if ((flags & GI_FIELD_ ## n1) != 0)  { \
-					lua_pushboolean(L, 1); \
-					lua_setfield(L, -2, #n2); \
-				}
-				H(IS_READABLE, is_readable)
-				H(IS_WRITABLE, is_writable)
-#undef H
-				return 1;
-		} else if (strcmp(prop, "size") == 0) {
-			lua_pushinteger(L, gi_field_info_get_size(GI_FIELD_INFO(*info)));
-			return 1;
-		} else if (strcmp(prop, "offset") == 0) {
-			lua_pushinteger(L, gi_field_info_get_offset(GI_FIELD_INFO(*info)));
+	case INFO_PROP_optional:
+		if (GI_IS_ARG_INFO(info)) {
+			lua_pushboolean(L, gi_arg_info_is_optional(GI_ARG_INFO(info))
+				|| gi_arg_info_may_be_null(GI_ARG_INFO(info)));
 			return 1;
 		}
-	}
+		break;
 
-	if (GI_IS_TYPE_INFO(*info)) {
-		GITypeTag tag = gi_type_info_get_tag(GI_TYPE_INFO(*info));
-		if (strcmp(prop, "tag") == 0) {
-			lua_pushstring(L, gi_type_tag_to_string(tag));
-			return 1;
-		} else if (strcmp(prop, "is_basic") == 0) {
-			lua_pushboolean(L, GI_TYPE_TAG_IS_BASIC(tag));
-			return 1;
-		} else if (strcmp(prop, "params") == 0) {
-			if (tag == GI_TYPE_TAG_ARRAY || tag == GI_TYPE_TAG_GLIST
-					|| tag == GI_TYPE_TAG_GSLIST
-					|| tag == GI_TYPE_TAG_GHASH) {
-				lua_newtable(L);
-				lua_gobject_gi_info_new(L,
-					GI_BASE_INFO(gi_type_info_get_param_type(
-						GI_TYPE_INFO(*info), 0)));
-				lua_rawseti(L, -2, 1);
-				if (tag == GI_TYPE_TAG_GHASH) {
-					lua_gobject_gi_info_new(L, GI_BASE_INFO(
-							gi_type_info_get_param_type(
-								GI_TYPE_INFO(*info), 1)));
-					lua_rawseti(L, -2, 2);
-				}
-				return 1;
-			}
-		} else if (strcmp(prop, "interface") == 0
-				&& tag == GI_TYPE_TAG_INTERFACE) {
-			lua_gobject_gi_info_new(L, gi_type_info_get_interface(
-					GI_TYPE_INFO(*info)));
-			return 1;
-		} else if (strcmp(prop, "array_type") == 0 && tag == GI_TYPE_TAG_ARRAY) {
-			switch(gi_type_info_get_array_type(GI_TYPE_INFO(*info))) {
-#define H(n1, n2) \
-			case GI_ARRAY_TYPE_ ## n1: \
-				lua_pushstring(L, #n2); \
-				return 1;
-
-			H(C, c)
-			H(ARRAY, array)
-			H(PTR_ARRAY, ptr_array)
-			H(BYTE_ARRAY, byte_array)
-#undef H
-			default:
-				g_assert_not_reached();
-			}
-		} else if (strcmp(prop, "is_zero_terminated") == 0
-				&& tag == GI_TYPE_TAG_ARRAY) {
-			lua_pushboolean(L, gi_type_info_is_zero_terminated(
-				GI_TYPE_INFO(*info)));
-			return 1;
-		} else if (strcmp(prop, "array_length") == 0) {
-			guint len;
-			if (gi_type_info_get_array_length_index(GI_TYPE_INFO(*info), &len)) {
-				lua_pushinteger(L, len);
-				return 1;
-			}
-		} else if (strcmp(prop, "fixed_size") == 0) {
-			gsize size;
-			if (gi_type_info_get_array_fixed_size(GI_TYPE_INFO(*info), &size)) {
-				lua_pushinteger(L, size);
-				return 1;
-			}
-		} else if (strcmp(prop, "is_pointer") == 0) {
-			lua_pushboolean(L, gi_type_info_is_pointer(GI_TYPE_INFO(*info)));
+	case INFO_PROP_offset:
+		if (GI_IS_FIELD_INFO(info)) {
+			lua_pushinteger(L, gi_field_info_get_offset(GI_FIELD_INFO(info)));
 			return 1;
 		}
+		break;
+
+	default:
+		/* The rest are properties of type info. */
+		if (GI_IS_TYPE_INFO(info))
+			return info_get_type(L, GI_TYPE_INFO(info), prop);
+		break;
 	}
 
 	lua_pushnil(L);
@@ -532,6 +745,38 @@ info_index(lua_State *L)
 #undef INFOS2
 }
 
+/* Upvalue 1 is the table mapping property names to their ids. */
+static int
+info_index(lua_State *L)
+{
+	GIBaseInfo **info = luaL_checkudata(L, 1, LUA_GOBJECT_GI_INFO);
+	int prop;
+
+	lua_pushvalue(L, 2);
+	lua_rawget(L, lua_upvalueindex(1));
+	if (lua_type(L, -1) != LUA_TNUMBER) {
+		lua_pushnil(L);
+		return 1;
+	}
+	prop = lua_tointeger(L, -1);
+	lua_pop(L, 1);
+	if (!info_prop_memo[prop])
+		return info_get(L, *info, prop);
+
+	/* Look the part up in already computed ones first. */
+	info_memo_get(L, 1);
+	lua_pushvalue(L, 2);
+	lua_rawget(L, -2);
+	if (lua_isnil(L, -1)) {
+		lua_pop(L, 1);
+		info_get(L, *info, prop);
+		lua_pushvalue(L, 2);
+		lua_pushvalue(L, -2);
+		lua_rawset(L, -4);
+	}
+	return 1;
+}
+
 static int
 info_eq(lua_State *L)
 {
@@ -546,12 +791,13 @@ info_gc(lua_State *L)
 {
 	GIBaseInfo **info = luaL_checkudata(L, 1, LUA_GOBJECT_GI_INFO);
 	gi_base_info_unref(*info);
+	lua_gobject_alloc_account(LUA_GOBJECT_ALLOC_GI_INFO,
+		-(gssize) sizeof(*info));
 	return 0;
 }
 
 static const luaL_Reg gi_info_reg[] = {
 	{ "__gc", info_gc },
-	{ "__index", info_index },
 	{ "__eq", info_eq },
 	{ NULL, NULL }
 };
@@ -564,7 +810,8 @@ resolver_index(lua_State *L)
 {
 	gpointer address;
 	GITypelib **typelib = luaL_checkudata(L, 1, LUA_GOBJECT_GI_RESOLVER);
-	if (gi_typelib_symbol(*typelib, luaL_checkstring(L, 2), &address)) {
+	if (lua_gobject_gi_typelib_symbol(*typelib, luaL_checkstring(L, 2),
+			&address)) {
 		lua_pushlightuserdata(L, address);
 		return 1;
 	}
@@ -736,6 +983,7 @@ static const Reg gi_reg[] = {
 static const luaL_Reg gi_api_reg[] = {
 	{ "require", gi_require },
 	{ "isinfo", gi_isinfo },
+	{ "names", gi_names },
 	{ NULL, NULL }
 };
 
@@ -743,6 +991,7 @@ void
 lua_gobject_gi_init(lua_State *L)
 {
 	const Reg *reg;
+	int i;
 
 	/* Register metatables for userdata objects. */
 	for (reg = gi_reg; reg->name; reg++) {
@@ -751,6 +1000,21 @@ lua_gobject_gi_init(lua_State *L)
 		lua_pop(L, 1);
 	}
 
+	/* Info properties are looked up by their ids in the table bound to __index. */
+	luaL_getmetatable(L, LUA_GOBJECT_GI_INFO);
+	lua_createtable(L, 0, INFO_PROP_COUNT);
+	for (i = 0; i < INFO_PROP_COUNT; i++) {
+		lua_pushinteger(L, i);
+		lua_setfield(L, -2, info_prop_names[i]);
+	}
+	lua_pushcclosure(L, info_index, 1);
+	lua_setfield(L, -2, "__index");
+	lua_pop(L, 1);
+
+	/* Create caches of info wrappers. */
+	lua_gobject_cache_create(L, &info_cache, "v");
+	lua_gobject_cache_create(L, &info_memo, "k");
+
 	/* Register global API. */
 	lua_newtable(L);
 	luaL_register(L, NULL, gi_api_reg);
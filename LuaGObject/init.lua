@@ -12,6 +12,10 @@ local package = require 'package'
 -- Require core LuaGObject utilities, used during bootstrap.
 local core = require 'LuaGObject.core'
 
+-- Startup tracing, if enabled.
+local trace = require 'LuaGObject.trace'
+local bootstrap = trace.enabled and trace.start()
+
 -- Create LuaGObject table, containing the module.
 local LuaGObject = {
 	_NAME = 'LuaGObject',
@@ -23,6 +27,12 @@ for _, name in pairs { 'yield', 'lock', 'enter', 'leave' } do
 	LuaGObject[name] = core[name]
 end
 
+-- Wrapper for callbacks whose invocations from foreign threads are queued instead of waiting for the state lock.
+LuaGObject.deferred = core.callable.deferred
+
+-- Pools of independent Lua states running on worker threads.
+LuaGObject.worker = core.worker
+
 -- If global package 'bytes' does not exist (i.e. not provided externally), use our internal (although incomplete) implementation.
 local ok, bytes = pcall(require, 'bytes')
 if not ok or not bytes then
@@ -78,6 +88,7 @@ repo.GLib._precondition = {}
 repo.GLib._precondition.Error = 'GLib-Error'
 repo.GLib._precondition.Bytes = 'GLib-Bytes'
 repo.GLib._precondition.Timer = 'GLib-Timer'
+repo.GLib._precondition.TimerWheel = 'GLib-TimerWheel'
 repo.GLib._precondition.MarkupParser = 'GLib-Markup'
 repo.GLib._precondition.MarkupParseContext = 'GLib-Markup'
 repo.GLib._precondition.Source = 'GLib-Source'
@@ -86,5 +97,7 @@ for _, name in pairs { 'Variant', 'VariantType', 'VariantBuilder' } do
 	repo.GLib._precondition[name] = 'GLib-Variant'
 end
 
+if bootstrap then trace.stop(bootstrap, 'init', 'LuaGObject') end
+
 -- Access to module proxies the whole repo, so that LuaGObject.'namespace' notation works.
 return setmetatable(LuaGObject, { __index = repo })
@@ -47,6 +47,7 @@ typedef unsigned long lua_gobject_Unsigned;
 #include <glib/gprintf.h>
 #include <girepository/girepository.h>
 #include <gmodule.h>
+#include <time.h>
 
 /* Makes sure that Lua stack offset is absolute one, not relative. */
 #define lua_gobject_makeabs(L, x) do { if (x < 0) x += lua_gettop (L) + 1; } while (0)
@@ -74,6 +75,31 @@ void lua_gobject_object_init (lua_State *L);
 void lua_gobject_callable_init (lua_State *L);
 void lua_gobject_gi_init (lua_State *L);
 void lua_gobject_buffer_init (lua_State *L);
+void lua_gobject_timerwheel_init (lua_State *L);
+void lua_gobject_worker_init (lua_State *L);
+
+/* Categories of allocations accounted for core.stats(). */
+typedef enum {
+	LUA_GOBJECT_ALLOC_CALLABLE,
+	LUA_GOBJECT_ALLOC_CLOSURE,
+	LUA_GOBJECT_ALLOC_GUARD,
+	LUA_GOBJECT_ALLOC_RECORD_EMBEDDED,
+	LUA_GOBJECT_ALLOC_RECORD,
+	LUA_GOBJECT_ALLOC_OBJECT,
+	LUA_GOBJECT_ALLOC_GI_INFO,
+	LUA_GOBJECT_ALLOC_ARRAY,
+	LUA_GOBJECT_ALLOC_LAST
+} LuaGObjectAlloc;
+
+/* Accounts allocation (positive size) or release (negative size) of given number of bytes in the category. */
+void lua_gobject_alloc_account (LuaGObjectAlloc category, gssize size);
+
+/* Census of live proxies, see core.census().  Each function fills table at absolute index 'census' with name -> { count, size } entries, using lua_gobject_census_add(). Object census returns number of GObject references held by proxies, record census number of nested records keeping their parents alive. */
+void lua_gobject_census_add (lua_State *L, int census, const char *name,
+			     gsize size);
+int lua_gobject_object_census (lua_State *L, int census);
+int lua_gobject_record_census (lua_State *L, int census);
+void lua_gobject_closure_census (lua_State *L, int census);
 
 /* Checks whether given argument is of specified udata - similar to luaL_testudata, which is missing in Lua 5.1 */
 void *
@@ -88,6 +114,10 @@ lua_gobject_udata_test (lua_State *L, int narg, const char *name);
 /* Creates new instance of info from given GIBaseInfo pointer. */
 int lua_gobject_gi_info_new (lua_State *L, GIBaseInfo *info);
 
+/* Thread-safe variant of gi_typelib_symbol(). */
+gboolean lua_gobject_gi_typelib_symbol (GITypelib *typelib, const gchar *symbol,
+					gpointer *address);
+
 /* Assumes that 'typetable' can hold field 'name' which contains wrapped LUA_GOBJECT_GI_INFO of function.  Returns address of this function, NULL if table does not contain such field. */
 gpointer lua_gobject_gi_load_function(lua_State *L, int typetable, const char *name);
 
@@ -98,6 +128,20 @@ gpointer lua_gobject_state_get_lock (lua_State *L);
 void lua_gobject_state_enter (gpointer left_state);
 void lua_gobject_state_leave (gpointer state_lock);
 
+/* Gets and sets whether the state lock is kept during all calls into C, see core.callable.single_threaded().  The setting belongs to the state and must be accessed only while holding its lock. */
+gboolean lua_gobject_state_get_single_threaded (gpointer state_lock);
+void lua_gobject_state_set_single_threaded (gpointer state_lock,
+					gboolean enabled);
+
+/* Attributes the current outermost hold of the state lock to given callable (or closure, if closure is set) in lock statistics; does nothing unless lock instrumentation is enabled. */
+void lua_gobject_state_mark (gpointer state_lock, GIBaseInfo *info,
+			     gboolean closure);
+
+/* Accounts a call of given callable made without releasing the state lock in lock statistics.  lua_gobject_state_hold_start() returns the start of the call, or 0 when lock instrumentation is disabled; lua_gobject_state_held() adds the time since then to the callable. */
+gint64 lua_gobject_state_hold_start (gpointer state_lock);
+void lua_gobject_state_held (gpointer state_lock, GIBaseInfo *info,
+			     gint64 start);
+
 /* Special value for 'parent' argument of marshal_2c/lua.  When parent is set to this value, marshalling takes place always into pointer on the C side.  This isuseful when marshalling value from/to lists, arrays and hashtables. */
 #define LUA_GOBJECT_PARENT_FORCE_POINTER G_MAXINT
 
@@ -146,6 +190,13 @@ gpointer lua_gobject_closure_create (lua_State* L, gpointer user_data,
 /* GDestroyNotify-compatible callback for destroying closure. */
 void lua_gobject_closure_destroy (gpointer user_data);
 
+/* Metatable name of userdata - persistent GAsyncReadyCallback trampoline. */
+#define LUA_GOBJECT_ASYNC_READY "lua_gobject.async_ready"
+
+/* If value at narg is async-ready trampoline, records it in closure block at *user_data and returns callback address; the trampoline is bound to the current thread and replaces the block only when the call's arguments are all marshalled.  Returns NULL if the trampoline cannot be used. */
+gpointer lua_gobject_async_ready_bind (lua_State *L, int narg,
+				gpointer *user_data);
+
 /* Allocates and creates new record instance. Assumes that repotype table is on the stack, replaces it with newly created proxy. */
 gpointer lua_gobject_record_new (lua_State *L, int count, gboolean alloc);
 
@@ -172,8 +223,74 @@ int lua_gobject_field_info_get_offset (GIFieldInfo *info);
 #define g_field_info_get_offset lua_gobject_field_info_get_offset
 #endif
 
+/* Use g_memdup2 when available */
+#if GLIB_CHECK_VERSION(2, 68, 0)
+#define lua_gobject_memdup  g_memdup2
+#else
+#define lua_gobject_memdup  g_memdup
+#endif
+
 /* Workaround method for broken g_object_info_get_*_function_pointer() in GI 1.32.0. (see https://bugzilla.gnome.org/show_bug.cgi?id=673282) */
 gpointer lua_gobject_object_get_function_ptr (GIObjectInfo *info,
 	const gchar *(*getter)(GIObjectInfo *));
 
 GIRepository *lua_gobject_gi_get_repository (void);
+
+/* Monotonic time in nanoseconds, used for profiling and tracing. */
+static inline gint64
+lua_gobject_clock_ns(void)
+{
+#ifdef CLOCK_MONOTONIC
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (gint64) ts.tv_sec * G_GINT64_CONSTANT(1000000000) + ts.tv_nsec;
+#else
+	return g_get_monotonic_time() * 1000;
+#endif
+}
+
+/* Static tracepoints of provider 'luagobject' for perf, bpftrace and systemtap.  They are compiled in only when built with LUA_GOBJECT_USDT defined (meson option 'usdt'), otherwise they expand to nothing, including evaluation of their arguments.  Every tracepoint has a semaphore, which is raised by the tracer while it is attached, so that arguments and timestamps are computed only when somebody listens. */
+#ifdef LUA_GOBJECT_USDT
+#define _SDT_HAS_SEMAPHORES 1
+#include <sys/sdt.h>
+#define LUA_GOBJECT_PROBES(P) \
+	P(call__entry) P(call__return) P(closure__entry) P(closure__return) \
+	P(object__new) P(object__gc) P(record__gc) \
+	P(lock__wait) P(lock__acquire) P(lock__release)
+#define LUA_GOBJECT_PROBE_DECLARE(name) \
+	extern unsigned short luagobject_ ## name ## _semaphore;
+LUA_GOBJECT_PROBES(LUA_GOBJECT_PROBE_DECLARE)
+#define LUA_GOBJECT_PROBE_ENABLED(name) \
+	G_UNLIKELY(luagobject_ ## name ## _semaphore != 0)
+#define LUA_GOBJECT_PROBE1(name, a1) G_STMT_START { \
+	if (LUA_GOBJECT_PROBE_ENABLED(name)) \
+		DTRACE_PROBE1(luagobject, name, a1); } G_STMT_END
+#define LUA_GOBJECT_PROBE2(name, a1, a2) G_STMT_START { \
+	if (LUA_GOBJECT_PROBE_ENABLED(name)) \
+		DTRACE_PROBE2(luagobject, name, a1, a2); } G_STMT_END
+#define LUA_GOBJECT_PROBE3(name, a1, a2, a3) G_STMT_START { \
+	if (LUA_GOBJECT_PROBE_ENABLED(name)) \
+		DTRACE_PROBE3(luagobject, name, a1, a2, a3); } G_STMT_END
+
+/* Start of the interval reported by given tracepoint; the clock is read only while the tracepoint is enabled. */
+#define LUA_GOBJECT_PROBE_START(name, var) \
+	gint64 var = LUA_GOBJECT_PROBE_ENABLED(name) ? lua_gobject_clock_ns() : 0
+#define LUA_GOBJECT_PROBE_ELAPSED(var) \
+	((var) != 0 ? lua_gobject_clock_ns() - (var) : 0)
+#else
+#define LUA_GOBJECT_PROBE1(name, a1) ((void) 0)
+#define LUA_GOBJECT_PROBE2(name, a1, a2) ((void) 0)
+#define LUA_GOBJECT_PROBE3(name, a1, a2, a3) ((void) 0)
+#define LUA_GOBJECT_PROBE_START(name, var) ((void) 0)
+#define LUA_GOBJECT_PROBE_ELAPSED(var) 0
+#endif
+
+/* Precompiled Lua modules embedded into the core (meson option 'embed-lua'), generated by tools/embed-lua.lua.  The table is terminated by an entry with NULL name. */
+#ifdef LUA_GOBJECT_EMBED
+typedef struct _LuaGObjectEmbedded {
+	const char *name;
+	const unsigned char *code;
+	gsize size;
+} LuaGObjectEmbedded;
+extern const LuaGObjectEmbedded lua_gobject_embedded[];
+#endif
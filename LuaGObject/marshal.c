@@ -7,13 +7,6 @@ Implements marshalling, i.e. transferring values between Lua and GLib/C. */
 #include <ffi.h>
 #include "lua_gobject.h"
 
-/* Use g_memdup2 when available */
-#if GLIB_CHECK_VERSION(2, 68, 0)
-#define lua_gobject_memdup  g_memdup2
-#else
-#define lua_gobject_memdup  g_memdup
-#endif
-
 /* Checks whether given argument contains number which fits given constraints. If yes, returns it, otherwise throws Lua error. */
 
 #if LUA_VERSION_NUM < 503
@@ -273,12 +266,29 @@ array_get_elt_size(GITypeInfo *ti, gboolean force_ptr)
 	return size;
 }
 
+/* Bytes of GArray accounted as LUA_GOBJECT_ALLOC_ARRAY. */
+static gssize
+array_accounted_size(GArray *array)
+{
+	return (gssize) g_array_get_element_size(array) * array->len;
+}
+
 static void
 array_detach(GArray *array)
 {
+	lua_gobject_alloc_account(LUA_GOBJECT_ALLOC_ARRAY,
+		-array_accounted_size(array));
 	g_array_free(array, FALSE);
 }
 
+static void
+array_release(GArray *array)
+{
+	lua_gobject_alloc_account(LUA_GOBJECT_ALLOC_ARRAY,
+		-array_accounted_size(array));
+	g_array_unref(array);
+}
+
 static void
 ptr_array_detach(GPtrArray *array)
 {
@@ -358,9 +368,11 @@ marshal_2c_array(lua_State *L, GITypeInfo *ti, GIArrayType atype,
 					array = g_array_sized_new(zero_terminated, TRUE, esize,
 						*out_size);
 					g_array_set_size(array, *out_size);
+					lua_gobject_alloc_account(LUA_GOBJECT_ALLOC_ARRAY,
+						array_accounted_size(array));
 					*lua_gobject_guard_create(L,(GDestroyNotify)
 						(transfer == GI_TRANSFER_EVERYTHING
-							? array_detach : g_array_unref)) = array;
+							? array_detach : array_release)) = array;
 					break;
 
 				case GI_ARRAY_TYPE_PTR_ARRAY:
@@ -796,6 +808,28 @@ marshal_2c_callable(lua_State *L, GICallableInfo *ci, GIArgInfo *ai,
 			return luaL_argerror(L, narg, "nil is not allowed");
 	}
 
+	/* Check persistent async-ready trampoline; it brings its own user_data, so that no closure has to be created. */
+	if (lua_gobject_udata_test(L, narg, LUA_GOBJECT_ASYNC_READY)) {
+		guint arg;
+		if (argci != NULL
+			&& gi_arg_info_get_scope(ai) == GI_SCOPE_TYPE_ASYNC
+			&& strcmp(gi_base_info_get_namespace(GI_BASE_INFO(ci)), "Gio") == 0
+			&& strcmp(gi_base_info_get_name(GI_BASE_INFO(ci)), "AsyncReadyCallback") == 0
+			&& gi_arg_info_get_closure_index(ai, &arg) && arg <(guint)nargs) {
+			*callback = lua_gobject_async_ready_bind(L, narg,
+				&((GIArgument *) args[arg])->v_pointer);
+			if (*callback != NULL) {
+				if (gi_arg_info_get_destroy_index(ai, &arg) && arg <(guint)nargs)
+					((GIArgument *) args[arg])->v_pointer = NULL;
+				return 0;
+			}
+		}
+
+		/* Fall back to ordinary closure resuming current thread. */
+		lua_pushthread(L);
+		lua_replace(L, narg);
+	}
+
 	/* Check lightuserdata case; simply use that data if provided. */
 	if (lua_islightuserdata(L, narg)) {
 		*callback = lua_touserdata(L, narg);
@@ -10,6 +10,7 @@ local enum = require 'LuaGObject.enum'
 local component = require 'LuaGObject.component'
 local record = require 'LuaGObject.record'
 local class = require 'LuaGObject.class'
+local trace = require 'LuaGObject.trace'
 
 -- Table containing loaders for various GI types, indexed by gi.InfoType constants.
 local typeloader = {}
@@ -73,13 +74,22 @@ function namespace.mt:__index(symbol)
 		local package = preconditions[symbol]
 		if not preconditions[package] then
 			preconditions[package] = true
-			require('LuaGObject.override.' .. package)
+			if trace.enabled then
+				trace.call('override', package, require,
+					'LuaGObject.override.' .. package)
+			else
+				require('LuaGObject.override.' .. package)
+			end
 			preconditions[package] = nil
 		end
 		preconditions[symbol] = nil
 		if not next(preconditions) then self._precondition = nil end
 	end
 
+	-- Override might have defined the symbol directly in the namespace.
+	val = rawget(self, symbol)
+	if val then return val end
+
 	-- Check, whether symbol is already loaded.
 	val = component.mt._element(self, nil, symbol, namespace.mt._categories)
 	if val then return val end
@@ -92,7 +102,12 @@ function namespace.mt:__index(symbol)
 	local loader = typeloader[info.type]
 	if loader then
 		local category
-		val, category = loader(self, info)
+		if trace.enabled then
+			val, category = trace.call('typeloader',
+				self._name .. '.' .. symbol, loader, self, info)
+		else
+			val, category = loader(self, info)
+		end
 
 		-- Cache the symbol in specified category in the namespace.
 		if val then
@@ -141,7 +156,13 @@ end
 -- Makes sure that the namespace (optionally with requested version) is properly loaded.
 function namespace.require(name, version)
 	-- Load the namespace info for GIRepository.  This also verifies whether requested version can be loaded.
-	local ns_info = assert(core.gi.require(name, version))
+	local ns_info
+	if trace.enabled then
+		ns_info = assert(trace.call('typelib', name, core.gi.require,
+			name, version))
+	else
+		ns_info = assert(core.gi.require(name, version))
+	end
 
 	-- If the repository table does not exist yet, create it.
 	local ns = rawget(core.repo, name)
@@ -160,7 +181,13 @@ function namespace.require(name, version)
 
 		-- Try to load override, if it is present.
 		local override_name = 'LuaGObject.override.' .. ns._name
-		local ok, msg = pcall(require, override_name)
+		local ok, msg
+		if trace.enabled then
+			ok, msg = trace.call('override', ns._name, pcall, require,
+				override_name)
+		else
+			ok, msg = pcall(require, override_name)
+		end
 		if not ok then
 			-- Try parsing message; if it is something different than "module xxx not found", then attempt to load again and let the exception fly out.
 			if not msg:find("module '" .. override_name .. "' not found:",
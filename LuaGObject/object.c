@@ -120,7 +120,8 @@ lua_gobject_object_get_function_ptr(GIObjectInfo *info,
 		/* Try to get the name and the symbol. */
 		func_name = getter(info);
 		if (func_name &&
-			gi_typelib_symbol(gi_base_info_get_typelib(GI_BASE_INFO(info)),
+			lua_gobject_gi_typelib_symbol(
+				gi_base_info_get_typelib(GI_BASE_INFO(info)),
 				func_name, &func)) {
 			gi_base_info_unref(info);
 			break;
@@ -234,7 +235,11 @@ object_unref(lua_State *L, gpointer obj)
 static int
 object_gc(lua_State *L)
 {
-	object_unref(L, object_get(L, 1));
+	gpointer obj = object_get(L, 1);
+	LUA_GOBJECT_PROBE2(object__gc, obj, G_TYPE_FROM_INSTANCE(obj));
+	lua_gobject_alloc_account(LUA_GOBJECT_ALLOC_OBJECT,
+		-(gssize) sizeof(obj));
+	object_unref(L, obj);
 
 	/* Unset the metatable / make the object unusable */
 	lua_pushnil(L);
@@ -313,7 +318,10 @@ lua_gobject_object_2lua(lua_State *L, gpointer obj, gboolean own, gboolean no_si
 	}
 
 	/* Create new userdata object. */
+	LUA_GOBJECT_PROBE3(object__new, obj, G_TYPE_FROM_INSTANCE(obj),
+		g_type_name(G_TYPE_FROM_INSTANCE(obj)));
 	*(gpointer *) lua_newuserdata(L, sizeof(obj)) = obj;
+	lua_gobject_alloc_account(LUA_GOBJECT_ALLOC_OBJECT, sizeof(obj));
 	lua_pushlightuserdata(L, &object_mt);
 	lua_rawget(L, LUA_REGISTRYINDEX);
 	lua_setmetatable(L, -2);
@@ -547,6 +555,27 @@ static const luaL_Reg object_api_reg[] = {
 	{ NULL, NULL }
 };
 
+int
+lua_gobject_object_census(lua_State *L, int census)
+{
+	int refs = 0;
+	lua_pushlightuserdata(L, &cache);
+	lua_rawget(L, LUA_REGISTRYINDEX);
+	lua_pushnil(L);
+	while (lua_next(L, -2)) {
+		gpointer obj = lua_touserdata(L, -2);
+		GType gtype = G_TYPE_FROM_INSTANCE(obj);
+		GTypeQuery query;
+		g_type_query(gtype, &query);
+		lua_gobject_census_add(L, census, g_type_name(gtype),
+			query.instance_size);
+		refs++;
+		lua_pop(L, 1);
+	}
+	lua_pop(L, 1);
+	return refs;
+}
+
 void
 lua_gobject_object_init(lua_State *L)
 {
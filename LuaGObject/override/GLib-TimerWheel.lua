@@ -0,0 +1,27 @@
+------------------------------------------------------------------------------
+--
+--  LuaGObject GLib TimerWheel support
+--
+--  Licensed under the MIT license:
+--  http://www.opensource.org/licenses/mit-license.php
+--
+------------------------------------------------------------------------------
+
+local setmetatable = setmetatable
+
+local LuaGObject = require 'LuaGObject'
+local core = require 'LuaGObject.core'
+
+local GLib = LuaGObject.GLib
+
+-- TimerWheel is not part of GLib itself, it is implemented natively
+-- in the core; wheel is driven by single GSource attached to given
+-- (or default) context.
+local new = core.timerwheel.new
+GLib.TimerWheel = setmetatable({
+      new = new,
+}, {
+   __call = function(_, resolution, priority, context)
+      return new(resolution, priority, context)
+   end,
+})
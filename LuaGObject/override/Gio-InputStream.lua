@@ -0,0 +1,38 @@
+------------------------------------------------------------------------------
+--
+--  LuaGObject Gio InputStream override module.
+--
+--  Copyright (c) 2010, 2011 Pavel Holejsovsky
+--  Licensed under the MIT license:
+--  http://www.opensource.org/licenses/mit-license.php
+--
+------------------------------------------------------------------------------
+
+local pairs = pairs
+local coroutine = require 'coroutine'
+
+local LuaGObject = require 'LuaGObject'
+local core = require 'LuaGObject.core'
+local gi = core.gi
+
+local Gio = LuaGObject.Gio
+
+-- Older versions of gio did not annotate input stream methods as
+-- taking an array.  Apply workaround.
+-- https://github.com/lgi-devs/lgi/issues/59
+for _, name in pairs { 'read', 'read_all', 'read_async' } do
+   local raw_read = Gio.InputStream[name]
+   if gi.Gio.InputStream.methods[name].args[1].typeinfo.tag ~= 'array' then
+      Gio.InputStream[name] = function(self, buffer, ...)
+	 return raw_read(self, buffer, #buffer, ...)
+      end
+      if name == 'read_async' then
+	 local raw_finish = Gio.InputStream.read_finish
+	 function Gio.InputStream.async_read(stream, buffer)
+	    raw_read(stream, buffer, Gio.Async.io_priority,
+		     Gio.Async.cancellable, coroutine.running())
+	    return raw_finish(coroutine.yield())
+	 end
+      end
+   end
+end
@@ -8,9 +8,10 @@
 --
 ------------------------------------------------------------------------------
 
-local select, type, pairs, setmetatable, rawset, unpack =
-   select, type, pairs, setmetatable, rawset, unpack or table.unpack
-local coroutine = require 'coroutine'
+local select, type, pairs, setmetatable, rawset, pcall, xpcall, unpack =
+   select, type, pairs, setmetatable, rawset, pcall, xpcall,
+   unpack or table.unpack
+local coroutine, debug = require 'coroutine', require 'debug'
 
 local LuaGObject = require 'LuaGObject'
 local GLib = LuaGObject.GLib
@@ -63,18 +64,33 @@ function Gio.Async.start(func, cancellable, io_priority)
    end
 end
 
+-- Whether coroutines can yield across pcall(), which is not the case
+-- in plain Lua 5.1.
+local yieldable_pcall = coroutine.wrap(function()
+   return pcall(coroutine.yield, true)
+end)()
+
 function Gio.Async.call(func, cancellable, io_priority)
-   -- Create mainloop which will create modality.
-   local loop = GLib.MainLoop()
-   local results
+   local results, failure
 
    -- Create coroutine around function wrapper which will invoke
-   -- target and then terminate the loop.
+   -- target and store its results.  Once the coroutine yields, it is
+   -- resumed by the callback of the async operation, which would only
+   -- log the error, so the error is caught together with its
+   -- traceback and rethrown by the starter.
    local coro = coroutine.create(function(...)
-	 (function(...)
-	     results = { n = select('#', ...), ... }
-	     loop:quit()
-	 end)(func(...))
+	 local store = function(...)
+	    results = { n = select('#', ...), ... }
+	 end
+	 if yieldable_pcall then
+	    local args = { n = select('#', ...), ... }
+	    local ok, err = xpcall(function()
+		  store(func(unpack(args, 1, args.n)))
+	    end, debug.traceback)
+	    if not ok then failure = { err } end
+	 else
+	    store(func(...))
+	 end
    end)
 
    -- Register coroutine.
@@ -82,22 +98,167 @@ function Gio.Async.call(func, cancellable, io_priority)
 
    -- Return starter closure.
    return function(...)
-      -- Spawn it inside idle handler, to avoid hang in case that
-      -- coroutine finishes during its first resuming.
-      local args = { n = select('#', ...), ... }
-      GLib.idle_add(
-	 GLib.PRIORITY_DEFAULT, function()
-	    coroutine.resume(coro, unpack(args, 1, args.n))
-      end)
-
-      -- Spin the loop.
-      loop:run()
+      -- Start the coroutine directly; if it does not finish during
+      -- its first run, iterate thread-default context (which is the
+      -- one async operations are dispatched in) until it does.  No
+      -- mainloop is needed, so nested calls are safe, each one just
+      -- waits for its own coroutine.
+      local ok, err = coroutine.resume(coro, ...)
+      if not ok then error(err, 0) end
+      if not results and not failure then
+	 local context = GLib.MainContext.ref_thread_default()
+	 repeat
+	    context:iteration(true)
+	 until results or failure or coroutine.status(coro) == 'dead'
+      end
+      if failure then error(failure[1], 0) end
+      if not results then
+	 -- Without yieldable pcall, only the place of the error is
+	 -- known.
+	 error(debug.traceback(
+		  coro, "Gio.Async.call: coroutine terminated with error"), 2)
+      end
 
       -- Unpack results.
       return unpack(results, 1, results.n)
    end
 end
 
+-- Packs all arguments into the table, storing their count in 'n'.
+local function pack(...)
+   return { n = select('#', ...), ... }
+end
+
+-- Checks whether packed results of async function denote failure,
+-- i.e. follow 'nil, err' convention.
+local function failed(res)
+   return res.n >= 2 and res[1] == nil and res[2] ~= nil
+end
+
+-- Runs all functions from 'funcs' concurrently, each in its own
+-- coroutine which inherits current async context except for its
+-- cancellable; children share a common cancellable which gets
+-- cancelled when the caller's one is.  'settle(finish, pending, i,
+-- results)' is called whenever child 'i' returns; 'finish(...)'
+-- cancels all remaining children and makes the calling coroutine
+-- return given values.  Optional 'setup(finish)' is called before
+-- any child is started.
+local function async_join(name, funcs, settle, setup)
+   local parent = coroutine.running()
+   local context = async_context[parent]
+   if not context then
+      error(("Gio.Async.%s: called out of async context"):format(name), 2)
+   end
+
+   -- Create children cancellable and chain it to the parent one.
+   local cancellable, handler = Gio.Cancellable()
+   if context.cancellable then
+      if context.cancellable:is_cancelled() then
+	 cancellable:cancel()
+      else
+	 handler = context.cancellable.on_cancelled:connect(
+	    function() cancellable:cancel() end)
+      end
+   end
+
+   local results, waiting
+   local function finish(...)
+      if results then return end
+      results = pack(...)
+      if handler then
+	 GObject.signal_handler_disconnect(context.cancellable, handler)
+      end
+      cancellable:cancel()
+      if waiting then
+	 waiting = false
+	 local ok, err = coroutine.resume(parent)
+	 if not ok then error(err, 0) end
+      end
+   end
+
+   local pending = #funcs
+   local function child_done(i, res)
+      if not results then
+	 pending = pending - 1
+	 settle(finish, pending, i, res)
+      end
+   end
+
+   if setup then setup(finish) end
+   for i = 1, #funcs do
+      if results then break end
+      local coro = coroutine.create(function()
+	    child_done(i, pack(funcs[i]()))
+      end)
+      register_async(coro, cancellable, context.io_priority)
+      local ok, err = coroutine.resume(coro)
+      if not ok then child_done(i, { n = 2, nil, err }) end
+   end
+   if not results and pending == 0 then settle(finish, 0) end
+
+   -- Wait until the join is complete.
+   if not results then
+      waiting = true
+      coroutine.yield()
+   end
+   return unpack(results, 1, results.n)
+end
+
+-- Runs all functions concurrently and waits for all of them.  Returns
+-- array of packed results, or nil and error of the first failed one.
+function Gio.Async.all(funcs)
+   local all = {}
+   return async_join('all', funcs, function(finish, pending, i, res)
+      if i then
+	 if failed(res) then return finish(nil, res[2]) end
+	 all[i] = res
+      end
+      if pending == 0 then finish(all) end
+   end)
+end
+
+-- Runs all functions concurrently, returns results of the first one
+-- which succeeds, or nil and the last error if all of them fail.
+function Gio.Async.any(funcs)
+   local err
+   return async_join('any', funcs, function(finish, pending, i, res)
+      if i then
+	 if not failed(res) then return finish(unpack(res, 1, res.n)) end
+	 err = res[2]
+      end
+      if pending == 0 then finish(nil, err) end
+   end)
+end
+
+-- Runs all functions concurrently, returns results of the first one
+-- which finishes, regardless whether it succeeded or failed.
+function Gio.Async.race(funcs)
+   return async_join('race', funcs, function(finish, pending, i, res)
+      if i then finish(unpack(res, 1, res.n)) else finish() end
+   end)
+end
+
+-- Runs function with given arguments, cancelling it if it does not
+-- finish in 'timeout' milliseconds.
+function Gio.Async.with_timeout(timeout, func, ...)
+   local args, source = pack(...)
+   return async_join(
+      'with_timeout', { function() return func(unpack(args, 1, args.n)) end },
+      function(finish, pending, i, res)
+	 if source then GLib.source_remove(source) end
+	 finish(unpack(res, 1, res.n))
+      end,
+      function(finish)
+	 source = GLib.timeout_add(
+	    GLib.PRIORITY_DEFAULT, timeout, function()
+	       source = nil
+	       finish(nil, GLib.Error(Gio.IOErrorEnum, 'TIMED_OUT',
+				      'Operation timed out'))
+	       return false
+	 end)
+      end)
+end
+
 -- Add 'async_' method handling.  Dynamically generates wrapper around
 -- xxx_async()/xxx_finish() sequence using currently running
 -- coroutine.
@@ -169,7 +330,15 @@ local function async_access(element, process_yield)
 	    index = index + 1
 	 end
       end
-      args[element.in_args] = coroutine.running()
+
+      -- Use persistent ready callback of the coroutine, which resumes
+      -- it without creating new closure for every operation.
+      local ready = context.ready
+      if not ready then
+	 ready = core.callable.async_ready()
+	 context.ready = ready
+      end
+      args[element.in_args] = ready
 
       element.async(unpack(args, 1, element.in_args))
       return element.finish(process_yield(coroutine.yield()))
@@ -212,6 +381,154 @@ function namespace.mt._category_mt._function:__index(key)
    return element and async_access(element, function(_, ...) return ... end)
 end
 
+-- Pumps all data from input stream 'src' into output stream 'dst',
+-- optionally passing it through the chain of Gio.Converter
+-- instances.  Reading and writing run in two separate coroutines
+-- which are connected through the ring of at most 'buffers' pending
+-- chunks, so that next read is already running while previous chunk
+-- is being written.  When the ring is full, the reader waits for the
+-- writer, and vice versa.  Must be called inside async context;
+-- cancellable and io_priority of the context are used for all
+-- operations.
+function Gio.Async.pipe(src, dst, options)
+   local context = async_context[coroutine.running()]
+   if not context then
+      error("Gio.Async.pipe: called out of async context", 2)
+   end
+   options = options or {}
+   local chunk = options.chunk or 65536
+   local nbuffers = options.buffers or 4
+
+   -- Wrap target stream into converter streams.  Data flows through
+   -- converters in the order in which they are specified, therefore
+   -- the outermost wrapper belongs to the first converter.
+   local converters = options.converters or {}
+   if type(converters) ~= 'table' then converters = { converters } end
+   local out, wrappers = dst, {}
+   for i = #converters, 1, -1 do
+      out = Gio.ConverterOutputStream.new(out, converters[i])
+      out:set_close_base_stream(false)
+      wrappers[#wrappers + 1] = out
+   end
+
+   -- Ring of pending chunks; slots are reused as the ring rotates.
+   local ring, first, count = {}, 1, 0
+   local eof, done, err
+   local total_read, total_written = 0, 0
+   local waiting = {}
+
+   -- Suspends current coroutine until the other side changes state
+   -- of the ring.
+   local function wait(side)
+      waiting[side] = coroutine.running()
+      coroutine.yield()
+   end
+
+   -- Resumes the other side, if it is waiting for us.
+   local function wake(side)
+      local coro = waiting[side]
+      if coro then
+	 waiting[side] = nil
+	 local ok, msg = coroutine.resume(coro)
+	 if not ok then
+	    err = err or msg
+	    if side == 'writer' then done = true end
+	 end
+      end
+   end
+
+   local function write_chunk(bytes)
+      local size, offset = bytes:get_size(), 0
+      while offset < size do
+	 local piece = bytes
+	 if offset > 0 then
+	    piece = GLib.Bytes.new_from_bytes(bytes, offset, size - offset)
+	 end
+	 local wrote, e = out:async_write_bytes(piece)
+	 if not wrote or wrote < 0 then return nil, e end
+	 offset = offset + wrote
+      end
+      total_written = total_written + size
+      return true
+   end
+
+   local function writer()
+      while not err do
+	 if count > 0 then
+	    local bytes = ring[first]
+	    ring[first] = false
+	    first = first % nbuffers + 1
+	    count = count - 1
+	    wake('reader')
+	    local ok, e = write_chunk(bytes)
+	    if not ok then err = err or e end
+	 elseif eof then
+	    break
+	 else
+	    wait('writer')
+	 end
+      end
+
+      -- Flush converters (innermost last) and optionally close target.
+      if not err then
+	 for i = #wrappers, 1, -1 do
+	    local ok, e = wrappers[i]:async_close()
+	    if not ok then err = e break end
+	 end
+      end
+      if not err and options.close then
+	 local ok, e = dst:async_close()
+	 if not ok then err = e end
+      end
+      done = true
+      wake('reader')
+   end
+
+   -- Start writer coroutine in the same async context.
+   local start = GLib.get_monotonic_time()
+   local ok, msg = Gio.Async.start(writer)()
+   if not ok then err, done = msg, true end
+
+   -- Read the source in the current coroutine.
+   while not err and not eof do
+      if count == nbuffers then
+	 wait('reader')
+      else
+	 local bytes, e = src:async_read_bytes(chunk)
+	 if not bytes then
+	    err = err or e
+	 elseif bytes:get_size() == 0 then
+	    eof = true
+	 else
+	    ring[(first + count - 1) % nbuffers + 1] = bytes
+	    count = count + 1
+	    total_read = total_read + bytes:get_size()
+	 end
+	 wake('writer')
+      end
+   end
+   if not err and options.close then
+      local ok, e = src:async_close()
+      if not ok then err = e end
+   end
+
+   -- Wait for the writer to drain the ring.
+   eof = true
+   while not done do
+      wake('writer')
+      if not done then wait('reader') end
+   end
+   if err then return nil, err end
+
+   local elapsed = (GLib.get_monotonic_time() - start) / 1000000
+   return {
+      read = total_read,
+      written = total_written,
+      elapsed = elapsed,
+      throughput = elapsed > 0 and total_read / elapsed or nil,
+   }
+end
+
 function Gio.Initable._init2(object)
    -- Avoid passing cancellable, because it might cause init() to
    -- fail, even if we could retrieve cancellable from async context.
@@ -227,38 +544,8 @@ function Gio.AsyncInitable._init1(object)
    return object:async_init()
 end
 
--- GOI < 1.30 did not map static factory method into interface
--- namespace.  The prominent example of this fault was that
--- Gio.File.new_for_path() had to be accessed as
--- Gio.file_new_for_path(). Create a compatibility layer to mask this
--- flaw.
-for _, name in pairs { 'path', 'uri', 'commandline_arg' } do
-   if not Gio.File['new_for_' .. name] then
-      Gio.File['new_for_' .. name] = Gio['file_new_for_' .. name]
-   end
-end
-
--- Older versions of gio did not annotate input stream methods as
--- taking an array.  Apply workaround.
--- https://github.com/lgi-devs/lgi/issues/59
-for _, name in pairs { 'read', 'read_all', 'read_async' } do
-   local raw_read = Gio.InputStream[name]
-   if gi.Gio.InputStream.methods[name].args[1].typeinfo.tag ~= 'array' then
-      Gio.InputStream[name] = function(self, buffer, ...)
-	 return raw_read(self, buffer, #buffer, ...)
-      end
-      if name == 'read_async' then
-	 raw_finish = Gio.InputStream.read_finish
-	 function Gio.InputStream.async_read(stream, buffer)
-	    raw_read(stream, buffer, Gio.Async.io_priority,
-		     Gio.Async.cancellable, coroutine.running())
-	    return raw_finish(coroutine.yield())
-	 end
-      end
-   end
-end
-
--- Add preconditions for auto-loading DBus overrides.
+-- Add preconditions for auto-loading DBus, File and InputStream
+-- overrides.
 Gio._precondition = {}
 for _, name in pairs {
    'AnnotationInfo', 'ArgInfo', 'MethodInfo', 'SignalInfo', 'PropertyInfo',
@@ -266,3 +553,5 @@ for _, name in pairs {
 } do
    Gio._precondition['DBus' .. name] = 'Gio-DBus'
 end
+Gio._precondition.File = 'Gio-File'
+Gio._precondition.InputStream = 'Gio-InputStream'
@@ -0,0 +1,77 @@
+------------------------------------------------------------------------------
+--
+--  LuaGObject Gtk3 Builder override module.
+--
+--  Copyright (c) 2010, 2011 Pavel Holejsovsky
+--  Licensed under the MIT license:
+--  http://www.opensource.org/licenses/mit-license.php
+--
+------------------------------------------------------------------------------
+
+local setmetatable = setmetatable
+local LuaGObject = require 'LuaGObject'
+local Gtk = LuaGObject.Gtk
+
+local log = LuaGObject.log.domain('LuaGObject.Gtk3')
+
+-------------------------------- Gtk.Builder overrides.
+Gtk.Builder._attribute = {}
+
+-- Override add_from_ family of functions, their C-signatures are
+-- completely braindead.
+local function builder_fix_return(res, e1, e2)
+   if res and res ~= 0 then return true end
+   return false, e1, e2
+end
+function Gtk.Builder:add_from_file(filename)
+   return builder_fix_return(Gtk.Builder._method.add_from_file(self, filename))
+end
+function Gtk.Builder:add_objects_from_file(filename, object_ids)
+   return builder_fix_return(Gtk.Builder._method.add_objects_from_file(
+                                self, filename, object_ids))
+end
+function Gtk.Builder:add_from_string(string, len)
+   if not len or len == -1 then len = #string end
+   return builder_fix_return(Gtk.Builder._method.add_from_string(
+                                self, string, len))
+end
+function Gtk.Builder:add_objects_from_string(string, len, object_ids)
+   if not len or len == -1 then len = #string end
+   return builder_fix_return(Gtk.Builder._method.add_objects_from_string(
+                                self, string, len, object_ids))
+end
+
+-- Wrapping get_object() using 'objects' attribute.
+Gtk.Builder._attribute.objects = {}
+local builder_objects_mt = {}
+function builder_objects_mt:__index(name)
+   return self._builder:get_object(name)
+end
+function Gtk.Builder._attribute.objects:get()
+   return setmetatable({ _builder = self }, builder_objects_mt)
+end
+
+-- Implementation of connect_signals() method.
+function Gtk.Builder._method:connect_signals(handlers)
+   local unconnected
+   self:connect_signals_full(
+      function(builder, object, signal, handler, connect_object, flags)
+         signal = 'on_' .. signal:gsub('%-', '_')
+         local target = handlers[handler]
+         if not target then
+            unconnected = unconnected or {}
+            unconnected[#unconnected + 1] = handler
+            log.warning("%s: failed to connect to `%s' handler",
+                        signal, handler)
+            return
+         end
+         local fun
+         if connect_object then
+            fun = function(_, ...) return target(connect_object, ...) end
+         else
+            fun = target
+         end
+         object[signal]:connect(fun, nil, flags.AFTER)
+      end)
+   return unconnected
+end
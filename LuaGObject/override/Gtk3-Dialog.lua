@@ -0,0 +1,25 @@
+------------------------------------------------------------------------------
+--
+--  LuaGObject Gtk3 Dialog override module.
+--
+--  Copyright (c) 2010, 2011 Pavel Holejsovsky
+--  Licensed under the MIT license:
+--  http://www.opensource.org/licenses/mit-license.php
+--
+------------------------------------------------------------------------------
+
+local ipairs = ipairs
+local LuaGObject = require 'LuaGObject'
+local Gtk = LuaGObject.Gtk
+
+-------------------------------- Gtk.Dialog
+Gtk.Dialog._attribute = { buttons = {} }
+
+function Gtk.Dialog._attribute.buttons:set(buttons)
+   for _, button in ipairs(buttons) do
+      self:add_button(button[1], button[2])
+   end
+end
+
+-------------------------------- Gtk.InfoBar
+Gtk.InfoBar._attribute = { buttons = Gtk.Dialog._attribute.buttons }
@@ -0,0 +1,22 @@
+------------------------------------------------------------------------------
+--
+--  LuaGObject Gtk3 EntryCompletion override module.
+--
+--  Copyright (c) 2010, 2011 Pavel Holejsovsky
+--  Licensed under the MIT license:
+--  http://www.opensource.org/licenses/mit-license.php
+--
+------------------------------------------------------------------------------
+
+local LuaGObject = require 'LuaGObject'
+local Gtk = LuaGObject.Gtk
+
+-------------------------------- Gtk.EntryCompletion
+
+-- Workaround for bug in GTK+; text_column accessors don't do an extra
+-- needed work which is done properly in
+-- gtk_entry_completion_{set/get}_text_column
+Gtk.EntryCompletion._attribute = {
+   text_column = { get = Gtk.EntryCompletion.get_text_column,
+                   set = Gtk.EntryCompletion.set_text_column }
+}
@@ -0,0 +1,30 @@
+------------------------------------------------------------------------------
+--
+--  LuaGObject Gtk3 Menu override module.
+--
+--  Copyright (c) 2010, 2011 Pavel Holejsovsky
+--  Licensed under the MIT license:
+--  http://www.opensource.org/licenses/mit-license.php
+--
+------------------------------------------------------------------------------
+
+local select = select
+local LuaGObject = require 'LuaGObject'
+local Gtk = LuaGObject.Gtk
+
+-------------------------------- Gtk.Menu
+function Gtk.Menu:popup(a1, a2, a3, a4, a5, ...)
+   if select('#', ...) > 0 then
+      Gtk.Menu.popup_for_device(self, a1, a2, a3, a4, a5, ...)
+   else
+      Gtk.Menu.popup_for_device(self, nil, a1, a2, a3, a4, a5)
+   end
+end
+
+-------------------------------- Gtk.MenuItem
+Gtk.MenuItem._attribute = { child = {} }
+function Gtk.MenuItem._attribute.child:get()
+   local children = Gtk.Container._attribute.child.get(self)
+   children[#children + 1] = Gtk.MenuItem.get_submenu(self)
+   return children
+end
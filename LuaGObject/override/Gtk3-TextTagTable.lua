@@ -0,0 +1,27 @@
+------------------------------------------------------------------------------
+--
+--  LuaGObject Gtk3 TextTagTable override module.
+--
+--  Copyright (c) 2010, 2011 Pavel Holejsovsky
+--  Licensed under the MIT license:
+--  http://www.opensource.org/licenses/mit-license.php
+--
+------------------------------------------------------------------------------
+
+local setmetatable = setmetatable
+local LuaGObject = require 'LuaGObject'
+local Gtk = LuaGObject.Gtk
+
+-------------------------------- Gtk.TextTagTable overrides.
+Gtk.TextTagTable._attribute = { tag = {} }
+
+local text_tag_table_tag_mt = {}
+function text_tag_table_tag_mt:__index(id)
+   return self._table:lookup(id)
+end
+function Gtk.TextTagTable._attribute.tag:get()
+   return setmetatable({ _table = self }, text_tag_table_tag_mt)
+end
+
+-- Map adding of tags in constructor array part to add() method.
+Gtk.TextTagTable._container_add = Gtk.TextTagTable.add
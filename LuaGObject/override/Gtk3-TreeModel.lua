@@ -0,0 +1,216 @@
+------------------------------------------------------------------------------
+--
+--  LuaGObject Gtk3 TreeModel override module.
+--
+--  Copyright (c) 2010, 2011 Pavel Holejsovsky
+--  Licensed under the MIT license:
+--  http://www.opensource.org/licenses/mit-license.php
+--
+------------------------------------------------------------------------------
+
+local select, type, pairs, ipairs, unpack, setmetatable
+   = select, type, pairs, ipairs, unpack or table.unpack, setmetatable
+local LuaGObject = require 'LuaGObject'
+local Gtk = LuaGObject.Gtk
+local GObject = LuaGObject.GObject
+
+-------------------------------- Gtk.TreeModel and relatives.
+Gtk.TreeModel._attribute = {}
+
+local tree_model_item_mt = {}
+function tree_model_item_mt:__index(column)
+   return self._model:get_value(self._iter, column - 1).value
+end
+function tree_model_item_mt:__newindex(column, val)
+   column = column - 1
+   local value = GObject.Value(self._model:get_column_type(column), val)
+   self._model:set_value(self._iter, column, value)
+end
+
+-- Map access of lines to iterators by directly indexing treemodel
+-- instance values with iterators.
+local tree_model_element = Gtk.TreeModel._element
+function Gtk.TreeModel:_element(model, key, origin)
+   if Gtk.TreeIter:is_type_of(key) then
+      return key, '_iter'
+   elseif Gtk.TreePath:is_type_of(key) then
+      return model:get_iter(key), '_iter'
+   end
+   local natres = {tree_model_element(self, model, key, origin)}
+   if #natres > 0 then return unpack(natres) end
+   if model ~= nil and (type(key) == 'number' or type(key) == 'string') then
+      local path = Gtk.TreePath.new_from_string(key)
+      if path then
+         return model:get_iter(path), '_iter'
+      end
+   end
+end
+function Gtk.TreeModel:_access_iter(model, iter, ...)
+   if select('#', ...) > 0 then
+      model:set(iter, ...)
+   else
+      -- Return proxy table allowing getting/setting individual columns.
+      return setmetatable({ _model = model, _iter = iter }, tree_model_item_mt)
+   end
+end
+
+local function treemodel_prepare_values(model, values)
+   local cols, vals = {}, {}
+   for column, value in pairs(values) do
+      local col = column - 1
+      cols[#cols + 1] = col
+      vals[#vals + 1] = GObject.Value(model:get_column_type(col), value)
+   end
+   return cols, vals
+end
+function Gtk.TreeModel:set(iter, values)
+   -- Set all values provided by the table
+   if Gtk.TreePath:is_type_of(iter) then iter = self:get_iter(iter) end
+   self:set_values(iter, treemodel_prepare_values(self, values))
+end
+
+-- Implement iteration protocol for model.
+function Gtk.TreeModel:next(iter)
+   if not iter or type(iter) == 'table' then
+      -- Start iteration.
+      iter = self:iter_children(iter and iter[1])
+   else
+      -- Continue to the next child.
+      if not self:iter_next(iter) then iter = nil end
+   end
+   return iter, iter and Gtk.TreeModel:_access_iter(self, iter)
+end
+function Gtk.TreeModel:pairs(parent)
+   return Gtk.TreeModel.next, self, parent and { parent }
+end
+
+-- Redirect 'set' method to our one inherited from TreeModel, it is
+-- the preferred one.  Rename the original to set_values().
+Gtk.ListStore._method.set_values = Gtk.ListStore.set
+Gtk.ListStore._method.set = nil
+Gtk.ListStore.set = nil
+
+-- Allow insert() and append() to handle also 'with_values' case.
+function Gtk.ListStore:insert(position, values)
+   local iter
+   if not values then
+      iter = Gtk.ListStore._method.insert(self, position)
+   else
+      iter = Gtk.ListStore._method.insert_with_valuesv(
+         self, position, treemodel_prepare_values(self, values))
+   end
+   return iter
+end
+if not Gtk.ListStore._method.insert_with_values then
+   Gtk.ListStore._method.insert_with_values =
+      Gtk.ListStore._method.insert_with_valuesv
+end
+function Gtk.ListStore:append(values)
+   local iter
+   if not values then
+      iter = Gtk.ListStore._method.append(self)
+   else
+      iter = Gtk.ListStore._method.insert_with_values(
+         self, -1, treemodel_prepare_values(self, values))
+   end
+   return iter
+end
+
+-- Similar treatment for treestore.
+Gtk.TreeStore._method.set_values = Gtk.TreeStore.set
+Gtk.TreeStore._method.set = nil
+Gtk.TreeStore.set = nil
+function Gtk.TreeStore:insert(parent, position, values)
+   local iter
+   if not values then
+      iter = Gtk.TreeStore._method.insert(self, parent, position)
+   else
+      iter = Gtk.TreeStore._method.insert_with_values(
+         self, parent, position, treemodel_prepare_values(self, values))
+   end
+   return iter
+end
+function Gtk.TreeStore:append(parent, values)
+   local iter
+   if not values then
+      iter = Gtk.TreeStore._method.append(self, parent)
+   else
+      iter = Gtk.TreeStore._method.insert_with_values(
+         self, parent, -1, treemodel_prepare_values(self, values))
+   end
+   return iter
+end
+
+-- Add missing constants, defined as anonymous enums in C headers, which
+-- is not supported by GIR yet.
+Gtk.TreeSortable.DEFAULT_SORT_COLUMN_ID = -1
+Gtk.TreeSortable.UNSORTED_SORT_COLUMN_ID = -2
+
+-------------------------------- Gtk.TreeView and support.
+-- Array part in constructor specifies columns to add.
+Gtk.TreeView._container_add = Gtk.TreeView.append_column
+
+-- Allow looking up tree column as child of the tree.
+Gtk.TreeView._attribute = {
+   child = { set = Gtk.TreeView._parent._attribute.child.set }
+}
+local treeview_child_mt = {}
+function treeview_child_mt:__index(id)
+   if self._view.id == id then return self._view end
+   for _, column in ipairs(self._view:get_columns()) do
+      local child = column.child[id]
+      if child then return child end
+   end
+end
+function Gtk.TreeView._attribute.child:get()
+   return setmetatable({ _view = self }, treeview_child_mt)
+end
+
+-- Sets attributes for specified cell.
+function Gtk.CellLayout:set(cell, data)
+   if type(data) == 'table' then
+      for attr, column in pairs(data) do
+         self:add_attribute(cell, attr, column - 1)
+      end
+   else
+      self:set_cell_data_func(cell, data)
+   end
+end
+
+-- Adds new cellrenderer with full definition into the column.
+function Gtk.CellLayout:add(def)
+   if def.align == 'start' then
+      self:pack_start(def[1], def.expand)
+   else
+      self:pack_end(def[1], def.expand)
+   end
+
+   -- Set attributes.
+   self:set(def[1], def[2])
+   if def.data_func then self:set_cell_data_func(def[1], def.data_func) end
+end
+
+-- Unfortunately, CellView is interface often implemented by descendants
+-- of Gtk.Container, so we cannot reuse generic _container_add here,
+-- because it is already occupied by implementing container's ctor.  So
+-- instead add attribute 'cells' which can be assigned the list of cell
+-- data definitions.
+Gtk.CellLayout._attribute = { cells = {}, child = {} }
+function Gtk.CellLayout._attribute.cells:set(cells)
+   for _, data in ipairs(cells) do Gtk.CellLayout.add(self, data) end
+end
+
+-- Allow lookuing up rendereres by assigned id.
+Gtk.CellRenderer._attribute = { id = Gtk.Buildable._attribute.id }
+local celllayout_child_mt = {}
+function celllayout_child_mt:__index(id)
+   if id == self._layout.id then return self._layout end
+   for _, renderer in ipairs(self._layout:get_cells()) do
+      if renderer.id == id then return renderer end
+   end
+end
+function Gtk.CellLayout._attribute.child:get()
+   return setmetatable({ _layout = self }, celllayout_child_mt)
+end
+
+Gtk.TreeViewColumn._container_add = Gtk.TreeViewColumn.add
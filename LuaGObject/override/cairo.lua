@@ -34,7 +34,9 @@ cairo._constant = {
    MIME_TYPE_JBIG2_GLOBAL_ID = 'application/x-cairo.jbig2-global-id',
 }
 
--- Load definitions of all enums.
+-- Load definitions of all enums.  Unlike Gtk overrides, cairo is not
+-- split into parts loaded on demand: specs of records below refer to
+-- enums and to each other while the override loads.
 cairo._enum = cairo._enum or {}
 for _, name in pairs {
    'Status', 'Content', 'Operator', 'Antialias', 'FillRule', 'LineCap',
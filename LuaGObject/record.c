@@ -63,6 +63,9 @@ lua_gobject_record_new(lua_State *L, int count, gboolean alloc)
 	/* Allocate new userdata for record object, attach proper metatable. */
 	record = lua_newuserdata(L,
 		G_STRUCT_OFFSET(Record, data) +(alloc ? 0 : size));
+	lua_gobject_alloc_account(alloc ? LUA_GOBJECT_ALLOC_RECORD
+		: LUA_GOBJECT_ALLOC_RECORD_EMBEDDED,
+		G_STRUCT_OFFSET(Record, data) +(alloc ? 0 : size));
 	lua_pushlightuserdata(L, &record_mt);
 	lua_rawget(L, LUA_REGISTRYINDEX);
 	lua_setmetatable(L, -2);
@@ -189,6 +192,8 @@ lua_gobject_record_2lua(lua_State *L, gpointer addr, gboolean own, int parent)
 
 	/* Allocate new userdata for record object, attach proper metatable. */
 	record = lua_newuserdata(L, G_STRUCT_OFFSET(Record, data));
+	lua_gobject_alloc_account(LUA_GOBJECT_ALLOC_RECORD,
+		G_STRUCT_OFFSET(Record, data));
 	lua_pushlightuserdata(L, &record_mt);
 	lua_rawget(L, LUA_REGISTRYINDEX);
 	lua_setmetatable(L, -2);
@@ -367,6 +372,10 @@ record_gc(lua_State *L)
 {
 	Record *record = record_get(L, 1);
 
+	LUA_GOBJECT_PROBE2(record__gc, record->addr, record->store);
+	lua_gobject_alloc_account(record->store == RECORD_STORE_EMBEDDED
+		? LUA_GOBJECT_ALLOC_RECORD_EMBEDDED : LUA_GOBJECT_ALLOC_RECORD,
+		-(gssize) lua_objlen(L, 1));
 	if (record->store == RECORD_STORE_EMBEDDED
 			|| record->store == RECORD_STORE_NESTED) {
 		/* Check whether record has registered '_uninit' function, and invoke it if yes. */
@@ -647,6 +656,37 @@ record_value_copy(const GValue *src, GValue *dest)
 	g_value_copy(src, dest);
 }
 
+int
+lua_gobject_record_census(lua_State *L, int census)
+{
+	int parents = 0;
+	lua_pushlightuserdata(L, &record_cache);
+	lua_rawget(L, LUA_REGISTRYINDEX);
+	lua_pushnil(L);
+	while (lua_next(L, -2)) {
+		/* Name the record after its typetable, native size is the size of the record type. */
+		lua_getfenv(L, -1);
+		lua_getfield(L, -1, "_size");
+		lua_getfield(L, -2, "_name");
+		lua_gobject_census_add(L, census,
+			lua_isstring(L, -1) ? lua_tostring(L, -1) : "?",
+			lua_tointeger(L, -2));
+		lua_pop(L, 4);
+	}
+	lua_pop(L, 1);
+
+	/* Count nested records which keep their parents alive. */
+	lua_pushlightuserdata(L, &parent_cache);
+	lua_rawget(L, LUA_REGISTRYINDEX);
+	lua_pushnil(L);
+	while (lua_next(L, -2)) {
+		parents++;
+		lua_pop(L, 1);
+	}
+	lua_pop(L, 1);
+	return parents;
+}
+
 void
 lua_gobject_record_init(lua_State *L)
 {
@@ -0,0 +1,474 @@
+/*
+ * Dynamic Lua binding to GObject using dynamic gobject-introspection.
+ *
+ * Licensed under the MIT license:
+ * http://www.opensource.org/licenses/mit-license.php
+ *
+ * This code implements hierarchical timer wheel, which keeps any number of Lua timers on single GSource and dispatches all expired timers in one entry into Lua.
+ */
+
+#include "lua_gobject.h"
+#include <string.h>
+
+/* Metatable name of timer wheel userdata. */
+#define UD_TIMERWHEEL "lua_gobject.timerwheel"
+
+/* Geometry of the wheel: WHEEL_LEVELS levels of WHEEL_SIZE slots each. Slot in level n covers WHEEL_SIZE^n ticks. */
+#define WHEEL_BITS 8
+#define WHEEL_SIZE (1 << WHEEL_BITS)
+#define WHEEL_MASK (WHEEL_SIZE - 1)
+#define WHEEL_LEVELS 4
+#define WHEEL_MAX_DELTA ((G_GUINT64_CONSTANT(1) << (WHEEL_BITS * WHEEL_LEVELS)) - 1)
+
+/* Single pending timer. */
+typedef struct _Timer {
+	/* Doubly-linked list of timers in the same slot. */
+	struct _Timer *next, **prev;
+
+	/* Identifier, also index of the Lua callback in callbacks table. */
+	gint64 id;
+
+	/* Tick in which the timer expires. */
+	guint64 expires;
+
+	/* Interval of the timer in ticks, used for rescheduling. */
+	guint64 interval;
+} Timer;
+
+typedef struct _TimerWheel TimerWheel;
+
+/* GSource driving the wheel. */
+typedef struct _TimerWheelSource {
+	GSource source;
+	TimerWheel *wheel;
+} TimerWheelSource;
+
+struct _TimerWheel {
+	/* Source which dispatches expired timers. */
+	GSource *source;
+
+	/* Thread used for invoking callbacks and reference to it. */
+	lua_State *L;
+	int thread_ref;
+
+	/* State lock, entered when source is dispatched. */
+	gpointer state_lock;
+
+	/* Reference to table with Lua callbacks, indexed by timer id. */
+	int callbacks_ref;
+
+	/* Reference to wheel userdata itself, held while any timer is pending. */
+	int self_ref;
+
+	/* Monotonic time of the tick 0 and length of the tick, both in microseconds. */
+	gint64 base, resolution;
+
+	/* First tick which was not processed yet. */
+	guint64 now;
+
+	/* All timers indexed by id, and id of the last added timer. */
+	GHashTable *timers;
+	gint64 last_id;
+
+	/* Wheel slots. */
+	Timer *slots[WHEEL_LEVELS][WHEEL_SIZE];
+};
+
+/* Links timer into the slot according to its expiration. */
+static void
+wheel_link(TimerWheel *wheel, Timer *timer)
+{
+	guint64 delta;
+	Timer **slot;
+	int level;
+
+	if (timer->expires < wheel->now)
+		timer->expires = wheel->now;
+	delta = timer->expires - wheel->now;
+	if (delta > WHEEL_MAX_DELTA) {
+		delta = WHEEL_MAX_DELTA;
+		timer->expires = wheel->now + delta;
+	}
+
+	for (level = 0; level < WHEEL_LEVELS - 1; level++)
+		if (delta < (G_GUINT64_CONSTANT(1) << (WHEEL_BITS * (level + 1))))
+			break;
+	slot = &wheel->slots[level][(timer->expires >> (WHEEL_BITS * level))
+		& WHEEL_MASK];
+
+	timer->next = *slot;
+	if (timer->next != NULL)
+		timer->next->prev = &timer->next;
+	timer->prev = slot;
+	*slot = timer;
+}
+
+/* Removes timer from its slot. */
+static void
+wheel_unlink(Timer *timer)
+{
+	if (timer->prev != NULL) {
+		*timer->prev = timer->next;
+		if (timer->next != NULL)
+			timer->next->prev = timer->prev;
+		timer->next = NULL;
+		timer->prev = NULL;
+	}
+}
+
+/* Moves all timers from given higher-level slot to the lower levels. Returns index of the slot. */
+static int
+wheel_cascade(TimerWheel *wheel, int level)
+{
+	int index = (wheel->now >> (WHEEL_BITS * level)) & WHEEL_MASK;
+	Timer *timer = wheel->slots[level][index];
+	wheel->slots[level][index] = NULL;
+	while (timer != NULL) {
+		Timer *next = timer->next;
+		wheel_link(wheel, timer);
+		timer = next;
+	}
+	return index;
+}
+
+/* Converts monotonic time to the tick. */
+static guint64
+wheel_tick(TimerWheel *wheel, gint64 time)
+{
+	return time <= wheel->base ? 0 : (time - wheel->base) / wheel->resolution;
+}
+
+/* Sets ready time of the source according to the earliest tick in which something needs to be done. */
+static void
+wheel_schedule(TimerWheel *wheel)
+{
+	guint64 tick;
+
+	if (g_hash_table_size(wheel->timers) == 0) {
+		g_source_set_ready_time(wheel->source, -1);
+		return;
+	}
+
+	/* Look for the nearest nonempty slot in the current round of level 0, otherwise wake up at its end to cascade higher levels. */
+	for (tick = wheel->now; ; tick++)
+		if (wheel->slots[0][tick & WHEEL_MASK] != NULL
+				|| (tick & WHEEL_MASK) == WHEEL_MASK)
+			break;
+	if (wheel->slots[0][tick & WHEEL_MASK] == NULL)
+		tick++;
+	g_source_set_ready_time(wheel->source,
+		wheel->base + (gint64) tick * wheel->resolution);
+}
+
+/* Keeps the wheel userdata (at index narg) alive while some timer is pending. */
+static void
+wheel_update_ref(lua_State *L, TimerWheel *wheel, int narg)
+{
+	if (g_hash_table_size(wheel->timers) > 0) {
+		if (wheel->self_ref == LUA_NOREF) {
+			lua_pushvalue(L, narg);
+			wheel->self_ref = luaL_ref(L, LUA_REGISTRYINDEX);
+		}
+	} else if (wheel->self_ref != LUA_NOREF) {
+		luaL_unref(L, LUA_REGISTRYINDEX, wheel->self_ref);
+		wheel->self_ref = LUA_NOREF;
+	}
+}
+
+/* Removes timer completely, including its Lua callback. */
+static void
+wheel_remove(lua_State *L, TimerWheel *wheel, Timer *timer)
+{
+	lua_rawgeti(L, LUA_REGISTRYINDEX, wheel->callbacks_ref);
+	lua_pushnil(L);
+	lua_rawseti(L, -2, timer->id);
+	lua_pop(L, 1);
+	wheel_unlink(timer);
+	g_hash_table_remove(wheel->timers, &timer->id);
+}
+
+static gboolean
+wheel_dispatch(GSource *source, GSourceFunc callback, gpointer user_data)
+{
+	TimerWheel *wheel = ((TimerWheelSource *) source)->wheel;
+	guint64 target = wheel_tick(wheel, g_source_get_time(source));
+	GArray *expired = g_array_new(FALSE, FALSE, sizeof(gint64));
+	lua_State *L;
+	guint i;
+	(void)callback;
+	(void)user_data;
+
+	lua_gobject_state_enter(wheel->state_lock);
+
+	/* Advance the wheel and collect all expired timers. */
+	while (wheel->now <= target) {
+		int index = wheel->now & WHEEL_MASK, level;
+		Timer *timer;
+		for (level = 1; index == 0 && level < WHEEL_LEVELS; level++)
+			index = wheel_cascade(wheel, level);
+
+		timer = wheel->slots[0][wheel->now & WHEEL_MASK];
+		wheel->slots[0][wheel->now & WHEEL_MASK] = NULL;
+		for (; timer != NULL; timer = timer->next) {
+			timer->prev = NULL;
+			g_array_append_val(expired, timer->id);
+		}
+		wheel->now++;
+
+		/* Skip quickly over empty wheel. */
+		if (g_hash_table_size(wheel->timers) == 0 && wheel->now <= target)
+			wheel->now = target + 1;
+	}
+
+	/* Invoke callbacks.  Callbacks might remove or reset any timer, so look each one up again before invoking it. */
+	L = wheel->L;
+	lua_settop(L, 0);
+	lua_rawgeti(L, LUA_REGISTRYINDEX, wheel->self_ref);
+	for (i = 0; i < expired->len; i++) {
+		gint64 id = g_array_index(expired, gint64, i);
+		Timer *timer = g_hash_table_lookup(wheel->timers, &id);
+		gboolean again = FALSE;
+		if (timer == NULL || timer->prev != NULL)
+			continue;
+
+		lua_rawgeti(L, LUA_REGISTRYINDEX, wheel->callbacks_ref);
+		lua_rawgeti(L, -1, id);
+		lua_remove(L, -2);
+		lua_pushinteger(L, (lua_Integer) id);
+		if (lua_pcall(L, 1, 1, 0) != 0)
+			g_warning("Error raised while calling timer callback: %s",
+				lua_tostring(L, -1));
+		else
+			again = lua_toboolean(L, -1);
+		lua_pop(L, 1);
+
+		/* Stop if the callback destroyed the whole wheel. */
+		if (wheel->source == NULL)
+			break;
+
+		/* Reschedule or remove the timer, unless the callback already handled it. */
+		timer = g_hash_table_lookup(wheel->timers, &id);
+		if (timer != NULL && timer->prev == NULL) {
+			if (again) {
+				timer->expires = target + timer->interval;
+				wheel_link(wheel, timer);
+			} else
+				wheel_remove(L, wheel, timer);
+		}
+	}
+	g_array_free(expired, TRUE);
+
+	if (wheel->source != NULL) {
+		wheel_schedule(wheel);
+		if (lua_isuserdata(L, 1))
+			wheel_update_ref(L, wheel, 1);
+	}
+	lua_settop(L, 0);
+	lua_gobject_state_leave(wheel->state_lock);
+	return G_SOURCE_CONTINUE;
+}
+
+static GSourceFuncs wheel_source_funcs = {
+	NULL, NULL, wheel_dispatch, NULL, NULL, NULL
+};
+
+static TimerWheel *
+wheel_check(lua_State *L, int narg)
+{
+	TimerWheel *wheel = luaL_checkudata(L, narg, UD_TIMERWHEEL);
+	if (wheel->source == NULL)
+		luaL_error(L, "timer wheel already destroyed");
+	return wheel;
+}
+
+/* Converts milliseconds to the number of ticks, rounding up. */
+static guint64
+wheel_ticks(lua_State *L, TimerWheel *wheel, int narg)
+{
+	lua_Number ms = luaL_checknumber(L, narg);
+	gint64 us = ms < 0 ? 0 : (gint64) (ms * 1000);
+	return (us + wheel->resolution - 1) / wheel->resolution;
+}
+
+/* Lua prototype: id = wheel:add(timeout_ms, callback)
+ Callback is called with id of the timer as argument.  If it returns true, timer is rescheduled with the same timeout, otherwise it is removed. */
+static int
+wheel_add(lua_State *L)
+{
+	TimerWheel *wheel = wheel_check(L, 1);
+	guint64 interval = wheel_ticks(L, wheel, 2);
+	Timer *timer;
+	luaL_checktype(L, 3, LUA_TFUNCTION);
+
+	/* Synchronize processed tick with the current time, so that timeout is counted from now. */
+	if (g_hash_table_size(wheel->timers) == 0)
+		wheel->now = wheel_tick(wheel, g_get_monotonic_time());
+
+	timer = g_new0(Timer, 1);
+	timer->id = ++wheel->last_id;
+	timer->interval = interval > 0 ? interval : 1;
+	timer->expires = wheel_tick(wheel, g_get_monotonic_time()) + interval;
+	g_hash_table_insert(wheel->timers, &timer->id, timer);
+	wheel_link(wheel, timer);
+
+	lua_rawgeti(L, LUA_REGISTRYINDEX, wheel->callbacks_ref);
+	lua_pushvalue(L, 3);
+	lua_rawseti(L, -2, timer->id);
+	lua_pop(L, 1);
+
+	wheel_update_ref(L, wheel, 1);
+	wheel_schedule(wheel);
+	lua_pushinteger(L, (lua_Integer) timer->id);
+	return 1;
+}
+
+/* Lua prototype: removed = wheel:remove(id) */
+static int
+wheel_remove_timer(lua_State *L)
+{
+	TimerWheel *wheel = wheel_check(L, 1);
+	gint64 id = luaL_checkinteger(L, 2);
+	Timer *timer = g_hash_table_lookup(wheel->timers, &id);
+	if (timer != NULL) {
+		wheel_remove(L, wheel, timer);
+		wheel_update_ref(L, wheel, 1);
+		wheel_schedule(wheel);
+	}
+	lua_pushboolean(L, timer != NULL);
+	return 1;
+}
+
+/* Lua prototype: found = wheel:reset(id[, timeout_ms])
+ Restarts the timer, optionally changing its timeout. */
+static int
+wheel_reset(lua_State *L)
+{
+	TimerWheel *wheel = wheel_check(L, 1);
+	gint64 id = luaL_checkinteger(L, 2);
+	Timer *timer = g_hash_table_lookup(wheel->timers, &id);
+	if (timer != NULL) {
+		if (!lua_isnoneornil(L, 3)) {
+			guint64 interval = wheel_ticks(L, wheel, 3);
+			timer->interval = interval > 0 ? interval : 1;
+		}
+		wheel_unlink(timer);
+		timer->expires = wheel_tick(wheel, g_get_monotonic_time())
+			+ timer->interval;
+		wheel_link(wheel, timer);
+		wheel_schedule(wheel);
+	}
+	lua_pushboolean(L, timer != NULL);
+	return 1;
+}
+
+/* Releases all timers and the source. */
+static int
+wheel_destroy(lua_State *L)
+{
+	TimerWheel *wheel = luaL_checkudata(L, 1, UD_TIMERWHEEL);
+	if (wheel->source != NULL) {
+		g_source_destroy(wheel->source);
+		g_source_unref(wheel->source);
+		wheel->source = NULL;
+		g_hash_table_destroy(wheel->timers);
+		wheel->timers = NULL;
+		luaL_unref(L, LUA_REGISTRYINDEX, wheel->callbacks_ref);
+		luaL_unref(L, LUA_REGISTRYINDEX, wheel->thread_ref);
+		luaL_unref(L, LUA_REGISTRYINDEX, wheel->self_ref);
+		wheel->self_ref = LUA_NOREF;
+	}
+	return 0;
+}
+
+static int
+wheel_len(lua_State *L)
+{
+	TimerWheel *wheel = luaL_checkudata(L, 1, UD_TIMERWHEEL);
+	lua_pushinteger(L, wheel->timers ? g_hash_table_size(wheel->timers) : 0);
+	return 1;
+}
+
+static int
+wheel_tostring(lua_State *L)
+{
+	TimerWheel *wheel = luaL_checkudata(L, 1, UD_TIMERWHEEL);
+	lua_pushfstring(L, "lua_gobject.timerwheel: %p", wheel);
+	return 1;
+}
+
+static const struct luaL_Reg wheel_reg[] = {
+	{ "add", wheel_add },
+	{ "remove", wheel_remove_timer },
+	{ "reset", wheel_reset },
+	{ "destroy", wheel_destroy },
+	{ "__gc", wheel_destroy },
+	{ "__len", wheel_len },
+	{ "__tostring", wheel_tostring },
+	{ NULL, NULL }
+};
+
+/* Lua prototype: wheel = core.timerwheel.new([resolution_ms[, priority[, context]]]) */
+static int
+wheel_new(lua_State *L)
+{
+	lua_Number resolution = luaL_optnumber(L, 1, 1);
+	int priority = (int) luaL_optinteger(L, 2, G_PRIORITY_DEFAULT);
+	GMainContext *context = NULL;
+	TimerWheel *wheel;
+
+	if (resolution <= 0)
+		return luaL_argerror(L, 1, "resolution must be positive");
+	if (!lua_isnoneornil(L, 3)) {
+		lua_gobject_type_get_repotype(L, G_TYPE_MAIN_CONTEXT, NULL);
+		lua_gobject_record_2c(L, 3, &context, FALSE, FALSE, FALSE, FALSE);
+	}
+
+	wheel = lua_newuserdata(L, sizeof(TimerWheel));
+	memset(wheel, 0, sizeof(TimerWheel));
+	luaL_getmetatable(L, UD_TIMERWHEEL);
+	lua_setmetatable(L, -2);
+
+	/* Dedicated thread for callbacks; the thread which created the wheel might be suspended when timers expire. */
+	wheel->L = lua_newthread(L);
+	wheel->thread_ref = luaL_ref(L, LUA_REGISTRYINDEX);
+	wheel->state_lock = lua_gobject_state_get_lock(L);
+	lua_newtable(L);
+	wheel->callbacks_ref = luaL_ref(L, LUA_REGISTRYINDEX);
+	wheel->self_ref = LUA_NOREF;
+	wheel->timers = g_hash_table_new_full(g_int64_hash, g_int64_equal,
+		NULL, g_free);
+	wheel->resolution = (gint64) (resolution * 1000);
+	if (wheel->resolution == 0)
+		wheel->resolution = 1;
+	wheel->base = g_get_monotonic_time();
+
+	wheel->source = g_source_new(&wheel_source_funcs,
+		sizeof(TimerWheelSource));
+	((TimerWheelSource *) wheel->source)->wheel = wheel;
+	g_source_set_priority(wheel->source, priority);
+	g_source_set_name(wheel->source, "LuaGObject timer wheel");
+	g_source_set_ready_time(wheel->source, -1);
+	g_source_attach(wheel->source, context);
+	return 1;
+}
+
+static const struct luaL_Reg timerwheel_reg[] = {
+	{ "new", wheel_new },
+	{ NULL, NULL }
+};
+
+void
+lua_gobject_timerwheel_init(lua_State *L)
+{
+	/* Register timer wheel metatable. */
+	luaL_newmetatable(L, UD_TIMERWHEEL);
+	luaL_register(L, NULL, wheel_reg);
+	lua_pushvalue(L, -1);
+	lua_setfield(L, -2, "__index");
+	lua_pop(L, 1);
+
+	/* Register public API. */
+	lua_newtable(L);
+	luaL_register(L, NULL, timerwheel_reg);
+	lua_setfield(L, -2, "timerwheel");
+}
@@ -0,0 +1,101 @@
+-- Startup tracing, enabled by LUAGOBJECT_TRACE_STARTUP environment variable.
+-- Licensed under the MIT license: http://www.opensource.org/licenses/mit-license.php
+
+local pairs, ipairs, setmetatable, getmetatable, rawget, _G
+	= pairs, ipairs, setmetatable, getmetatable, rawget, _G
+local io, table, string = require 'io', require 'table', require 'string'
+local core = require 'LuaGObject.core'
+
+-- When tracing is not enabled, the module contains only the 'enabled' flag, which call sites check.
+local trace = { enabled = core.startup ~= nil }
+if not trace.enabled then return trace end
+
+local clock = core.clock
+
+-- Accumulated entries, keyed by 'kind name'; each with kind, name, count, total and self times in nanoseconds.
+local entries = {}
+
+-- Stack of currently running phases, each with start time and time spent in nested phases.
+local stack = {}
+
+local function add(kind, name, total, self)
+	local key = kind .. ' ' .. name
+	local entry = entries[key]
+	if not entry then
+		entry = { kind = kind, name = name, count = 0, total = 0, self = 0 }
+		entries[key] = entry
+	end
+	entry.count = entry.count + 1
+	entry.total = entry.total + total
+	entry.self = entry.self + self
+end
+
+-- Starts timing of a phase.  Returns token to be passed to trace.stop().
+function trace.start()
+	local frame = { start = clock(), nested = 0 }
+	stack[#stack + 1] = frame
+	return frame
+end
+
+-- Finishes timing of a phase started by trace.start().
+function trace.stop(frame, kind, name)
+	local total = clock() - frame.start
+
+	-- Unwind frames of phases which were interrupted by an error.
+	while #stack > 0 do
+		local top = stack[#stack]
+		stack[#stack] = nil
+		if top == frame then break end
+	end
+	add(kind, name, total, total - frame.nested)
+	local parent = stack[#stack]
+	if parent then parent.nested = parent.nested + total end
+end
+
+-- Runs function as a phase, passing through all its results.
+function trace.call(kind, name, func, ...)
+	local frame = trace.start()
+	local function finish(...)
+		trace.stop(frame, kind, name)
+		return ...
+	end
+	return finish(func(...))
+end
+
+-- Returns entries sorted by self time.
+function trace.report()
+	local report = {}
+	for _, entry in pairs(entries) do report[#report + 1] = entry end
+	table.sort(report, function(a, b) return a.self > b.self end)
+	return report
+end
+
+-- Prints the report to stderr.
+function trace.print()
+	local report = trace.report()
+	local out = io.stderr
+	out:write(string.format(
+		'LuaGObject startup: %.2f ms since the core was opened\n',
+		(clock() - core.startup.start) * 1e-6))
+	out:write(string.format('%10s %10s %6s  %-10s %s\n',
+		'self ms', 'total ms', 'count', 'kind', 'name'))
+	for _, entry in ipairs(report) do
+		out:write(string.format('%10.3f %10.3f %6d  %-10s %s\n',
+			entry.self * 1e-6, entry.total * 1e-6, entry.count,
+			entry.kind, entry.name))
+	end
+end
+
+-- Opening of the core itself happened before this module was loaded.
+add('core', 'lua_gobject_core', core.startup.open, core.startup.open)
+
+-- Print the report when the state is closed, i.e. usually at exit.
+local newproxy = rawget(_G, 'newproxy')
+if newproxy then
+	trace.sentinel = newproxy(true)
+	getmetatable(trace.sentinel).__gc = function() trace.print() end
+else
+	trace.sentinel = setmetatable({}, { __gc = function() trace.print() end })
+end
+
+return trace
@@ -0,0 +1,807 @@
+/*
+ * Dynamic Lua binding to GObject using dynamic gobject-introspection.
+ *
+ * Licensed under the MIT license:
+ * http://www.opensource.org/licenses/mit-license.php
+ *
+ * This code implements worker pools: sets of independent Lua states running on GThreadPool, communicating with the owning state only by serialized messages.
+ */
+
+#include "lua_gobject.h"
+#include <string.h>
+#include <lualib.h>
+
+/* Metatable name of worker pool userdata. */
+#define UD_WORKER "lua_gobject.worker"
+
+/* Maximum nesting of tables in a message; also catches cyclic tables. */
+#define MESSAGE_MAX_DEPTH 64
+
+/* Tags of serialized values. */
+enum {
+	MESSAGE_NIL = 'n',
+	MESSAGE_TRUE = 't',
+	MESSAGE_FALSE = 'f',
+	MESSAGE_NUMBER = 'd',
+	MESSAGE_INTEGER = 'i',
+	MESSAGE_STRING = 's',
+	MESSAGE_TABLE = 'T',
+	MESSAGE_OBJECT = 'o',
+	MESSAGE_VARIANT = 'v'
+};
+
+/* Single Lua state of the pool, together with its handler function. */
+typedef struct _WorkerState {
+	lua_State *L;
+	gpointer state_lock;
+	int handler_ref;
+} WorkerState;
+
+/* Single unit of work.  message holds arguments when the job is queued and results when it is finished. */
+typedef struct _WorkerJob {
+	struct _WorkerJob *next;
+	gint64 id;
+	GByteArray *message;
+	gboolean ok;
+} WorkerJob;
+
+typedef struct _WorkerPool WorkerPool;
+
+/* GSource delivering finished jobs. */
+typedef struct _WorkerSource {
+	GSource source;
+	WorkerPool *pool;
+} WorkerSource;
+
+struct _WorkerPool {
+	/* Threads running the jobs and idle Lua states ready to run them. */
+	GThreadPool *threads;
+	GAsyncQueue *idle;
+
+	/* Chunk returning the handler, and module search paths of the owning state. */
+	gchar *code, *path, *cpath;
+	gsize code_len;
+
+	/* Source which delivers results, thread used for invoking callbacks and reference to it. */
+	GSource *source;
+	lua_State *L;
+	int thread_ref;
+	gpointer state_lock;
+
+	/* Table with result callbacks indexed by job id, and reference to pool userdata itself, held while any job is pending. */
+	int callbacks_ref;
+	int self_ref;
+	gint64 last_id;
+	guint pending;
+
+	/* Lock-free stack of finished jobs. */
+	WorkerJob *done;
+
+	/* Set while results are delivered; closing the pool from a callback then leaves releasing the references to the delivering loop. */
+	gboolean flushing, released;
+};
+
+static void
+message_put(GByteArray *message, guint8 tag, gconstpointer data, gsize size)
+{
+	g_byte_array_append(message, &tag, 1);
+	if (size > 0)
+		g_byte_array_append(message, data, size);
+}
+
+/* Appends value at given index to the message.  GObjects and GVariants are referenced, the reference is owned by the message. */
+static void
+message_encode(lua_State *L, int narg, GByteArray *message, int depth)
+{
+	lua_gobject_makeabs(L, narg);
+	switch (lua_type(L, narg)) {
+	case LUA_TNIL:
+		message_put(message, MESSAGE_NIL, NULL, 0);
+		break;
+
+	case LUA_TBOOLEAN:
+		message_put(message, lua_toboolean(L, narg)
+			? MESSAGE_TRUE : MESSAGE_FALSE, NULL, 0);
+		break;
+
+	case LUA_TNUMBER:
+		if (lua_isinteger(L, narg)) {
+			lua_Integer val = lua_tointeger(L, narg);
+			message_put(message, MESSAGE_INTEGER, &val, sizeof(val));
+		} else {
+			lua_Number val = lua_tonumber(L, narg);
+			message_put(message, MESSAGE_NUMBER, &val, sizeof(val));
+		}
+		break;
+
+	case LUA_TSTRING:
+		{
+			size_t len;
+			const char *str = lua_tolstring(L, narg, &len);
+			message_put(message, MESSAGE_STRING, &len, sizeof(len));
+			g_byte_array_append(message, (const guint8 *) str, len);
+		}
+		break;
+
+	case LUA_TTABLE:
+		{
+			guint32 count = 0;
+			guint offset;
+			if (depth >= MESSAGE_MAX_DEPTH)
+				luaL_error(L, "table nested too deep (cyclic table?)");
+			luaL_checkstack(L, 3, "");
+
+			/* Count of pairs is patched after all of them are stored. */
+			message_put(message, MESSAGE_TABLE, &count, sizeof(count));
+			offset = message->len - sizeof(count);
+			lua_pushnil(L);
+			while (lua_next(L, narg) != 0) {
+				message_encode(L, -2, message, depth + 1);
+				message_encode(L, -1, message, depth + 1);
+				lua_pop(L, 1);
+				count++;
+				memcpy(message->data + offset, &count, sizeof(count));
+			}
+		}
+		break;
+
+	case LUA_TUSERDATA:
+		{
+			gpointer obj = lua_gobject_object_2c(L, narg, G_TYPE_INVALID,
+				FALSE, TRUE, FALSE);
+			if (obj != NULL) {
+				g_object_ref(obj);
+				message_put(message, MESSAGE_OBJECT, &obj, sizeof(obj));
+				break;
+			}
+
+			lua_gobject_type_get_repotype(L, G_TYPE_VARIANT, NULL);
+			if (!lua_isnil(L, -1)) {
+				lua_gobject_record_2c(L, narg, &obj, FALSE, FALSE, FALSE, TRUE);
+				if (obj != NULL) {
+					g_variant_ref(obj);
+					message_put(message, MESSAGE_VARIANT, &obj, sizeof(obj));
+					break;
+				}
+			} else
+				lua_pop(L, 1);
+		}
+		/* Fall through. */
+
+	default:
+		luaL_error(L, "%s cannot be passed to worker",
+			luaL_typename(L, narg));
+	}
+}
+
+/* Reads data of given size from the message, returns FALSE if the message is truncated. */
+static gboolean
+message_get(const guint8 **pos, const guint8 *end, gpointer data, gsize size)
+{
+	if ((gsize) (end - *pos) < size)
+		return FALSE;
+	memcpy(data, *pos, size);
+	*pos += size;
+	return TRUE;
+}
+
+/* Reads data of given size from the message, raises an error if the message is truncated. */
+static void
+message_check(lua_State *L, const guint8 **pos, const guint8 *end,
+	gpointer data, gsize size)
+{
+	if (!message_get(pos, end, data, size))
+		luaL_error(L, "corrupt worker message");
+}
+
+/* Pushes value stored at *pos to the stack.  Ownership of GObjects and GVariants is passed to the created proxies.  Raises an error when the message is truncated or corrupt. */
+static void
+message_decode(lua_State *L, const guint8 **pos, const guint8 *end, int depth)
+{
+	guint8 tag = 0;
+	luaL_checkstack(L, 4, "");
+	message_check(L, pos, end, &tag, 1);
+	switch (tag) {
+	case MESSAGE_NIL:
+		lua_pushnil(L);
+		break;
+
+	case MESSAGE_TRUE:
+	case MESSAGE_FALSE:
+		lua_pushboolean(L, tag == MESSAGE_TRUE);
+		break;
+
+	case MESSAGE_INTEGER:
+		{
+			lua_Integer val;
+			message_check(L, pos, end, &val, sizeof(val));
+			lua_pushinteger(L, val);
+		}
+		break;
+
+	case MESSAGE_NUMBER:
+		{
+			lua_Number val;
+			message_check(L, pos, end, &val, sizeof(val));
+			lua_pushnumber(L, val);
+		}
+		break;
+
+	case MESSAGE_STRING:
+		{
+			size_t len;
+			message_check(L, pos, end, &len, sizeof(len));
+			if ((gsize) (end - *pos) < len)
+				luaL_error(L, "corrupt worker message");
+			lua_pushlstring(L, (const char *) *pos, len);
+			*pos += len;
+		}
+		break;
+
+	case MESSAGE_TABLE:
+		{
+			guint32 count;
+			message_check(L, pos, end, &count, sizeof(count));
+
+			/* Every pair takes at least two tags. */
+			if (depth >= MESSAGE_MAX_DEPTH
+					|| (gsize) (end - *pos) / 2 < count)
+				luaL_error(L, "corrupt worker message");
+			lua_createtable(L, 0, count);
+			while (count-- > 0) {
+				message_decode(L, pos, end, depth + 1);
+				message_decode(L, pos, end, depth + 1);
+				if (lua_isnil(L, -2))
+					lua_pop(L, 2);
+				else
+					lua_rawset(L, -3);
+			}
+		}
+		break;
+
+	case MESSAGE_OBJECT:
+		{
+			gpointer obj;
+			message_check(L, pos, end, &obj, sizeof(obj));
+			lua_gobject_object_2lua(L, obj, TRUE, FALSE);
+		}
+		break;
+
+	case MESSAGE_VARIANT:
+		{
+			gpointer variant;
+			message_check(L, pos, end, &variant, sizeof(variant));
+			lua_gobject_type_get_repotype(L, G_TYPE_VARIANT, NULL);
+			lua_gobject_record_2lua(L, variant, TRUE, 0);
+		}
+		break;
+
+	default:
+		luaL_error(L, "corrupt worker message");
+	}
+}
+
+/* Pushes all values of the job's message to the stack and releases the message.  If decoding fails, the message is released by a guard. */
+static void
+message_unpack(lua_State *L, WorkerJob *job)
+{
+	GByteArray **message;
+	const guint8 *pos, *end;
+	int guard;
+
+	/* Values which were decoded already are owned by their proxies, so the message must not be freed by message_free() anymore. */
+	message = (GByteArray **) lua_gobject_guard_create(L,
+		(GDestroyNotify) g_byte_array_unref);
+	guard = lua_gettop(L);
+	*message = job->message;
+	job->message = NULL;
+	pos = (*message)->data;
+	end = pos + (*message)->len;
+	while (pos < end)
+		message_decode(L, &pos, end, 0);
+	g_byte_array_unref(*message);
+	*message = NULL;
+	lua_remove(L, guard);
+}
+
+/* Frees the message, releasing all references it owns.  The message might be truncated, if its encoding failed halfway. */
+static void
+message_free(gpointer data)
+{
+	GByteArray *message = data;
+	const guint8 *pos = message->data, *end = pos + message->len;
+	guint8 tag;
+	while (message_get(&pos, end, &tag, 1)) {
+		gpointer ptr;
+		gsize skip = 0;
+		switch (tag) {
+		case MESSAGE_INTEGER:
+			skip = sizeof(lua_Integer);
+			break;
+		case MESSAGE_NUMBER:
+			skip = sizeof(lua_Number);
+			break;
+		case MESSAGE_TABLE:
+			skip = sizeof(guint32);
+			break;
+		case MESSAGE_STRING:
+			{
+				size_t len;
+				if (message_get(&pos, end, &len, sizeof(len)))
+					skip = len;
+			}
+			break;
+		case MESSAGE_OBJECT:
+		case MESSAGE_VARIANT:
+			if (message_get(&pos, end, &ptr, sizeof(ptr))) {
+				if (tag == MESSAGE_OBJECT)
+					g_object_unref(ptr);
+				else
+					g_variant_unref(ptr);
+			}
+			break;
+		}
+		if ((gsize) (end - pos) < skip)
+			break;
+		pos += skip;
+	}
+	g_byte_array_unref(message);
+}
+
+/* Creates new Lua state loading LuaGObject and running pool's code to get the handler.  Called from the pool thread; returned state is entered. */
+static WorkerState *
+worker_state_new(WorkerPool *pool, gchar **error)
+{
+	lua_State *L = luaL_newstate();
+	WorkerState *state;
+	if (L == NULL) {
+		*error = g_strdup("not enough memory for worker state");
+		return NULL;
+	}
+
+	luaL_openlibs(L);
+	lua_getglobal(L, "package");
+	lua_pushstring(L, pool->path);
+	lua_setfield(L, -2, "path");
+	lua_pushstring(L, pool->cpath);
+	lua_setfield(L, -2, "cpath");
+	lua_pop(L, 1);
+
+	lua_getglobal(L, "require");
+	lua_pushliteral(L, "LuaGObject");
+	if (lua_pcall(L, 1, 0, 0) != 0
+			|| luaL_loadbuffer(L, pool->code, pool->code_len, "=worker") != 0
+			|| lua_pcall(L, 0, 1, 0) != 0) {
+		const char *message = lua_tostring(L, -1);
+		*error = g_strdup(message ? message : "worker initialization failed");
+		lua_close(L);
+		return NULL;
+	}
+	if (lua_type(L, -1) != LUA_TFUNCTION) {
+		*error = g_strdup("worker code must return a function");
+		lua_close(L);
+		return NULL;
+	}
+
+	state = g_new(WorkerState, 1);
+	state->L = L;
+	state->handler_ref = luaL_ref(L, LUA_REGISTRYINDEX);
+	state->state_lock = lua_gobject_state_get_lock(L);
+	return state;
+}
+
+static void
+worker_state_free(WorkerState *state)
+{
+	/* Closing the state releases its lock, so it must be held. */
+	lua_gobject_state_enter(state->state_lock);
+	lua_close(state->L);
+	g_free(state);
+}
+
+/* Runs the job inside worker state.  Lua prototype: worker_invoke(job, state) */
+static int
+worker_invoke(lua_State *L)
+{
+	WorkerJob *job = lua_touserdata(L, 1);
+	WorkerState *state = lua_touserdata(L, 2);
+	GByteArray **result;
+	int i, top;
+
+	/* Arguments are owned by the proxies once decoded. */
+	lua_rawgeti(L, LUA_REGISTRYINDEX, state->handler_ref);
+	message_unpack(L, job);
+	lua_call(L, lua_gettop(L) - 3, LUA_MULTRET);
+
+	/* Keep the result guarded until it is complete, so that it is freed when encoding fails. */
+	top = lua_gettop(L);
+	result = (GByteArray **) lua_gobject_guard_create(L, message_free);
+	*result = g_byte_array_new();
+	for (i = 3; i <= top; i++)
+		message_encode(L, i, *result, 0);
+	job->message = *result;
+	*result = NULL;
+	return 0;
+}
+
+/* GThreadPool function: runs the job in some idle state and queues it for delivery. */
+static void
+worker_run(gpointer data, gpointer user_data)
+{
+	WorkerJob *job = data;
+	WorkerPool *pool = user_data;
+	WorkerState *state = g_async_queue_try_pop(pool->idle);
+	gchar *error = NULL;
+
+	/* There is never more running jobs than threads, so new state is created only until there is one for every thread. */
+	if (state != NULL)
+		lua_gobject_state_enter(state->state_lock);
+	else
+		state = worker_state_new(pool, &error);
+
+	if (state != NULL) {
+		lua_State *L = state->L;
+		lua_pushcfunction(L, worker_invoke);
+		lua_pushlightuserdata(L, job);
+		lua_pushlightuserdata(L, state);
+		job->ok = lua_pcall(L, 2, 0, 0) == 0;
+		if (!job->ok) {
+			const char *message = lua_tostring(L, -1);
+			error = g_strdup(message ? message : "error in worker");
+		}
+		lua_settop(L, 0);
+		lua_gobject_state_leave(state->state_lock);
+		g_async_queue_push(pool->idle, state);
+	}
+
+	/* Failed job delivers the error message as its only result. */
+	if (error != NULL) {
+		gsize len = strlen(error);
+		if (job->message != NULL)
+			message_free(job->message);
+		job->ok = FALSE;
+		job->message = g_byte_array_new();
+		message_put(job->message, MESSAGE_STRING, &len, sizeof(len));
+		g_byte_array_append(job->message, (const guint8 *) error, len);
+		g_free(error);
+	}
+
+	/* Push the finished job and wake up the delivering source. */
+	do
+		job->next = g_atomic_pointer_get(&pool->done);
+	while (!g_atomic_pointer_compare_and_exchange(&pool->done, job->next, job));
+	g_source_set_ready_time(pool->source, 0);
+}
+
+/* Delivers results of the job to its callback.  Lua prototype: worker_deliver(job, callback) */
+static int
+worker_deliver(lua_State *L)
+{
+	WorkerJob *job = lua_touserdata(L, 1);
+	lua_pushboolean(L, job->ok);
+	message_unpack(L, job);
+	if (lua_isnil(L, 2)) {
+		if (!job->ok)
+			g_warning("Error raised in worker: %s", lua_tostring(L, 4));
+		return 0;
+	}
+
+	lua_call(L, lua_gettop(L) - 2, 0);
+	return 0;
+}
+
+static void worker_release(lua_State *L, WorkerPool *pool);
+
+/* Delivers all finished jobs, in the order in which they finished. */
+static void
+worker_flush(WorkerPool *pool)
+{
+	WorkerJob *job, *list;
+	lua_State *L = pool->L;
+
+	if (pool->flushing)
+		return;
+	pool->flushing = TRUE;
+	lua_settop(L, 0);
+	lua_rawgeti(L, LUA_REGISTRYINDEX, pool->self_ref);
+	lua_rawgeti(L, LUA_REGISTRYINDEX, pool->callbacks_ref);
+
+	/* Jobs finished by the callbacks (e.g. when they close the pool) are delivered in the next round. */
+	while ((job = g_atomic_pointer_get(&pool->done)) != NULL) {
+		while (!g_atomic_pointer_compare_and_exchange(&pool->done, job, NULL))
+			job = g_atomic_pointer_get(&pool->done);
+		for (list = NULL; job != NULL;) {
+			WorkerJob *next = job->next;
+			job->next = list;
+			list = job;
+			job = next;
+		}
+
+		for (job = list; job != NULL; job = list) {
+			list = job->next;
+			lua_pushcfunction(L, worker_deliver);
+			lua_pushlightuserdata(L, job);
+			lua_rawgeti(L, 2, job->id);
+			lua_pushnil(L);
+			lua_rawseti(L, 2, job->id);
+			if (lua_pcall(L, 2, 0, 0) != 0) {
+				g_warning("Error raised while calling worker callback: %s",
+					lua_tostring(L, -1));
+				lua_pop(L, 1);
+			}
+			if (job->message != NULL)
+				message_free(job->message);
+			g_free(job);
+
+			/* Release the pool once nothing is pending. */
+			if (--pool->pending == 0 && pool->self_ref != LUA_NOREF) {
+				luaL_unref(L, LUA_REGISTRYINDEX, pool->self_ref);
+				pool->self_ref = LUA_NOREF;
+			}
+		}
+	}
+	lua_settop(L, 0);
+	pool->flushing = FALSE;
+
+	/* Pool was closed by one of the callbacks. */
+	if (pool->threads == NULL)
+		worker_release(L, pool);
+}
+
+static gboolean
+worker_dispatch(GSource *source, GSourceFunc callback, gpointer user_data)
+{
+	WorkerPool *pool = ((WorkerSource *) source)->pool;
+	gpointer state_lock = pool->state_lock;
+	(void)callback;
+	(void)user_data;
+
+	/* The pool might be released by the flush. */
+	g_source_set_ready_time(source, -1);
+	lua_gobject_state_enter(state_lock);
+	worker_flush(pool);
+	lua_gobject_state_leave(state_lock);
+	return G_SOURCE_CONTINUE;
+}
+
+static GSourceFuncs worker_source_funcs = {
+	NULL, NULL, worker_dispatch, NULL, NULL, NULL
+};
+
+static WorkerPool *
+worker_check(lua_State *L, int narg)
+{
+	WorkerPool *pool = luaL_checkudata(L, narg, UD_WORKER);
+	if (pool->threads == NULL)
+		luaL_error(L, "worker pool already closed");
+	return pool;
+}
+
+/* Lua prototype: id = pool:send(callback, ...)
+ Runs the handler with given arguments in one of the worker states.  Callback is invoked from the main context as callback(true, results...) or callback(false, message); it may be nil. */
+static int
+worker_send(lua_State *L)
+{
+	WorkerPool *pool = worker_check(L, 1);
+	GByteArray **message;
+	GError *err = NULL;
+	WorkerJob *job;
+	int i, top = lua_gettop(L);
+	if (!lua_isnil(L, 2))
+		luaL_checktype(L, 2, LUA_TFUNCTION);
+
+	message = (GByteArray **) lua_gobject_guard_create(L, message_free);
+	*message = g_byte_array_new();
+	for (i = 3; i <= top; i++)
+		message_encode(L, i, *message, 0);
+
+	job = g_new0(WorkerJob, 1);
+	job->id = ++pool->last_id;
+	job->message = *message;
+	*message = NULL;
+
+	lua_rawgeti(L, LUA_REGISTRYINDEX, pool->callbacks_ref);
+	lua_pushvalue(L, 2);
+	lua_rawseti(L, -2, job->id);
+	lua_pop(L, 1);
+	if (pool->self_ref == LUA_NOREF) {
+		lua_pushvalue(L, 1);
+		pool->self_ref = luaL_ref(L, LUA_REGISTRYINDEX);
+	}
+	pool->pending++;
+
+	if (!g_thread_pool_push(pool->threads, job, &err)) {
+		lua_rawgeti(L, LUA_REGISTRYINDEX, pool->callbacks_ref);
+		lua_pushnil(L);
+		lua_rawseti(L, -2, job->id);
+		lua_pop(L, 1);
+		if (--pool->pending == 0) {
+			luaL_unref(L, LUA_REGISTRYINDEX, pool->self_ref);
+			pool->self_ref = LUA_NOREF;
+		}
+		message_free(job->message);
+		g_free(job);
+		lua_pushstring(L, err->message);
+		g_error_free(err);
+		return luaL_error(L, "%s", lua_tostring(L, -1));
+	}
+
+	lua_pushinteger(L, (lua_Integer) job->id);
+	return 1;
+}
+
+/* Waits for all jobs and releases the pool.  Results of finished jobs are delivered only if deliver is set. */
+static void
+worker_shutdown(lua_State *L, WorkerPool *pool, gboolean deliver)
+{
+	WorkerState *state;
+	WorkerJob *job;
+
+	if (pool->threads == NULL)
+		return;
+
+	/* Jobs might need to enter this state (e.g. by emitting signals on shared objects), so do not hold it while waiting. */
+	lua_gobject_state_leave(pool->state_lock);
+	g_thread_pool_free(pool->threads, FALSE, TRUE);
+	lua_gobject_state_enter(pool->state_lock);
+	pool->threads = NULL;
+
+	/* When closed from a callback, the delivering loop picks up the remaining jobs itself. */
+	if (deliver)
+		worker_flush(pool);
+	else {
+		for (job = g_atomic_pointer_get(&pool->done); job != NULL;) {
+			WorkerJob *next = job->next;
+			if (job->message != NULL)
+				message_free(job->message);
+			g_free(job);
+			job = next;
+		}
+		pool->done = NULL;
+	}
+
+	while ((state = g_async_queue_try_pop(pool->idle)) != NULL)
+		worker_state_free(state);
+	g_async_queue_unref(pool->idle);
+	g_free(pool->code);
+	g_free(pool->path);
+	g_free(pool->cpath);
+
+	/* Delivering loop still uses the callbacks table and the thread, it releases them when it returns. */
+	if (!pool->flushing)
+		worker_release(L, pool);
+}
+
+/* Releases the source and registry references of the closed pool. */
+static void
+worker_release(lua_State *L, WorkerPool *pool)
+{
+	if (pool->released)
+		return;
+	pool->released = TRUE;
+	g_source_destroy(pool->source);
+	g_source_unref(pool->source);
+	luaL_unref(L, LUA_REGISTRYINDEX, pool->callbacks_ref);
+	luaL_unref(L, LUA_REGISTRYINDEX, pool->thread_ref);
+	luaL_unref(L, LUA_REGISTRYINDEX, pool->self_ref);
+	pool->self_ref = LUA_NOREF;
+}
+
+/* Lua prototype: pool:close()
+ Waits until all sent jobs are finished, delivers their results and closes all worker states. */
+static int
+worker_close(lua_State *L)
+{
+	worker_shutdown(L, luaL_checkudata(L, 1, UD_WORKER), TRUE);
+	return 0;
+}
+
+static int
+worker_gc(lua_State *L)
+{
+	worker_shutdown(L, luaL_checkudata(L, 1, UD_WORKER), FALSE);
+	return 0;
+}
+
+static int
+worker_len(lua_State *L)
+{
+	WorkerPool *pool = luaL_checkudata(L, 1, UD_WORKER);
+	lua_pushinteger(L, pool->pending);
+	return 1;
+}
+
+static int
+worker_tostring(lua_State *L)
+{
+	WorkerPool *pool = luaL_checkudata(L, 1, UD_WORKER);
+	lua_pushfstring(L, "lua_gobject.worker: %p", pool);
+	return 1;
+}
+
+static const struct luaL_Reg worker_reg[] = {
+	{ "send", worker_send },
+	{ "close", worker_close },
+	{ "__gc", worker_gc },
+	{ "__len", worker_len },
+	{ "__tostring", worker_tostring },
+	{ NULL, NULL }
+};
+
+/* Lua prototype: pool = core.worker.new(code[, threads[, context]])
+ Code is Lua chunk which returns handler function; it is run once in every worker state. */
+static int
+worker_new(lua_State *L)
+{
+	size_t code_len;
+	const char *code = luaL_checklstring(L, 1, &code_len);
+	int threads = (int) luaL_optinteger(L, 2, g_get_num_processors());
+	GMainContext *context = NULL;
+	GError *err = NULL;
+	WorkerPool *pool;
+
+	if (threads <= 0)
+		return luaL_argerror(L, 2, "number of threads must be positive");
+	if (!lua_isnoneornil(L, 3)) {
+		lua_gobject_type_get_repotype(L, G_TYPE_MAIN_CONTEXT, NULL);
+		lua_gobject_record_2c(L, 3, &context, FALSE, FALSE, FALSE, FALSE);
+	}
+
+	pool = lua_newuserdata(L, sizeof(WorkerPool));
+	memset(pool, 0, sizeof(WorkerPool));
+	pool->threads = g_thread_pool_new(worker_run, pool, threads, FALSE, &err);
+	if (pool->threads == NULL) {
+		lua_pushstring(L, err->message);
+		g_error_free(err);
+		return luaL_error(L, "%s", lua_tostring(L, -1));
+	}
+	luaL_getmetatable(L, UD_WORKER);
+	lua_setmetatable(L, -2);
+
+	/* Worker states look up modules in the same places as this one. */
+	lua_getglobal(L, "package");
+	lua_getfield(L, -1, "path");
+	pool->path = g_strdup(lua_tostring(L, -1));
+	lua_getfield(L, -2, "cpath");
+	pool->cpath = g_strdup(lua_tostring(L, -1));
+	lua_pop(L, 3);
+	pool->code = lua_gobject_memdup(code, code_len);
+	pool->code_len = code_len;
+	pool->idle = g_async_queue_new();
+
+	/* Dedicated thread for callbacks; the thread which created the pool might be suspended when results arrive. */
+	pool->L = lua_newthread(L);
+	pool->thread_ref = luaL_ref(L, LUA_REGISTRYINDEX);
+	pool->state_lock = lua_gobject_state_get_lock(L);
+	lua_newtable(L);
+	pool->callbacks_ref = luaL_ref(L, LUA_REGISTRYINDEX);
+	pool->self_ref = LUA_NOREF;
+
+	pool->source = g_source_new(&worker_source_funcs, sizeof(WorkerSource));
+	((WorkerSource *) pool->source)->pool = pool;
+	g_source_set_name(pool->source, "LuaGObject worker");
+	g_source_set_ready_time(pool->source, -1);
+	g_source_attach(pool->source, context);
+	return 1;
+}
+
+static const struct luaL_Reg worker_api_reg[] = {
+	{ "new", worker_new },
+	{ NULL, NULL }
+};
+
+void
+lua_gobject_worker_init(lua_State *L)
+{
+	/* Register worker pool metatable. */
+	luaL_newmetatable(L, UD_WORKER);
+	luaL_register(L, NULL, worker_reg);
+	lua_pushvalue(L, -1);
+	lua_setfield(L, -2, "__index");
+	lua_pop(L, 1);
+
+	/* Register public API. */
+	lua_newtable(L);
+	luaL_register(L, NULL, worker_api_reg);
+	lua_setfield(L, -2, "worker");
+}
@@ -0,0 +1,491 @@
+------------------------------------------------------------------------------
+--
+--  LuaGObject benchmark suite
+--
+--  Licensed under the MIT license:
+--  http://www.opensource.org/licenses/mit-license.php
+--
+--  Usage: lua benchmark.lua [options] [pattern...]
+--    --output FILE      write results as JSON into FILE
+--    --baseline FILE    compare against results saved earlier by --output
+--    --threshold PCT    slowdown in percent reported as regression (10)
+--    --time SECONDS     minimal measured time of each benchmark (0.2)
+--    --suite NAME       run given suite instead of the default one;
+--                       'marshal' measures marshalling of each type tag,
+--                       direction and transfer in ns per element
+--
+--  Each option can also be given in the environment as
+--  LUAGOBJECT_BENCH_<OPTION>, e.g. LUAGOBJECT_BENCH_BASELINE, which is
+--  the only way to pass them through 'meson test --benchmark'.
+--  Benchmarks whose names match none of given patterns are skipped.
+--
+------------------------------------------------------------------------------
+
+local LuaGObject = require 'LuaGObject'
+local core = require 'LuaGObject.core'
+local GLib = LuaGObject.GLib
+local unpack = unpack or table.unpack
+
+local options = {
+   output = os.getenv('LUAGOBJECT_BENCH_OUTPUT'),
+   baseline = os.getenv('LUAGOBJECT_BENCH_BASELINE'),
+   threshold = tonumber(os.getenv('LUAGOBJECT_BENCH_THRESHOLD') or 10),
+   time = tonumber(os.getenv('LUAGOBJECT_BENCH_TIME') or 0.2),
+   suite = os.getenv('LUAGOBJECT_BENCH_SUITE') or 'default',
+   patterns = {},
+}
+do
+   local i = 1
+   while arg and arg[i] do
+      local name = arg[i]:match('^%-%-(.*)$')
+      if name then
+	 if options[name] == nil and name ~= 'output'
+	    and name ~= 'baseline' then
+	    error(("unknown option '--%s'"):format(name))
+	 end
+	 options[name] = arg[i + 1]
+	 i = i + 2
+      else
+	 options.patterns[#options.patterns + 1] = arg[i]
+	 i = i + 1
+      end
+   end
+   options.threshold = tonumber(options.threshold)
+   options.time = tonumber(options.time)
+end
+
+------------------------------------------------------------------------------
+-- Minimal JSON support, sufficient for results written by this script.
+
+local json = {}
+
+function json.encode(value, indent)
+   indent = indent or ''
+   local kind = type(value)
+   if kind == 'table' then
+      local keys = {}
+      for key in pairs(value) do keys[#keys + 1] = key end
+      table.sort(keys)
+      local inner, parts = indent .. '  ', {}
+      for _, key in ipairs(keys) do
+	 parts[#parts + 1] = ('%s%s: %s'):format(
+	    inner, json.encode(tostring(key)), json.encode(value[key], inner))
+      end
+      if #parts == 0 then return '{}' end
+      return '{\n' .. table.concat(parts, ',\n') .. '\n' .. indent .. '}'
+   elseif kind == 'string' then
+      return '"' .. value:gsub('[%c"\\]', function(c)
+	 return ('\\u%04x'):format(c:byte())
+      end) .. '"'
+   elseif kind == 'number' then
+      return ('%.17g'):format(value)
+   else
+      return tostring(value)
+   end
+end
+
+function json.decode(text)
+   local pos = 1
+   local value
+   local function skip()
+      pos = text:find('[^%s]', pos) or #text + 1
+   end
+   local function fail()
+      error(('malformed JSON at position %d'):format(pos))
+   end
+   function value()
+      skip()
+      local c = text:sub(pos, pos)
+      if c == '{' or c == '[' then
+	 local result, close, n = {}, c == '{' and '}' or ']', 0
+	 pos = pos + 1
+	 skip()
+	 if text:sub(pos, pos) == close then
+	    pos = pos + 1
+	    return result
+	 end
+	 repeat
+	    local key
+	    if close == '}' then
+	       key = value()
+	       skip()
+	       if text:sub(pos, pos) ~= ':' then fail() end
+	       pos = pos + 1
+	    else
+	       n = n + 1
+	       key = n
+	    end
+	    result[key] = value()
+	    skip()
+	    c = text:sub(pos, pos)
+	    pos = pos + 1
+	 until c ~= ','
+	 if c ~= close then fail() end
+	 return result
+      elseif c == '"' then
+	 local close = text:find('"', pos + 1, true) or fail()
+	 local s = text:sub(pos + 1, close - 1)
+	 pos = close + 1
+	 return (s:gsub('\\u(%x%x%x%x)', function(code)
+	    return string.char(tonumber(code, 16))
+	 end))
+      else
+	 local literal = text:match('^[%w%.%+%-]+', pos) or fail()
+	 pos = pos + #literal
+	 if literal == 'true' then return true
+	 elseif literal == 'false' then return false
+	 elseif literal == 'null' then return nil end
+	 return tonumber(literal) or fail()
+      end
+   end
+   return value()
+end
+
+------------------------------------------------------------------------------
+-- Measurement.
+
+-- Returns number of allocations made by the binding so far.
+local function allocations()
+   local count = 0
+   for _, category in pairs(core.stats().alloc) do
+      count = count + category.allocs
+   end
+   return count
+end
+
+-- Runs given function in batches of growing size until the whole batch takes at least the requested time.  Returns ns/op, allocations/op and number of iterations of the measured batch.
+local function measure(func)
+   local iterations = 1
+   func()
+   while true do
+      collectgarbage()
+      local allocs = allocations()
+      local start = GLib.get_monotonic_time()
+      for _ = 1, iterations do func() end
+      local elapsed = (GLib.get_monotonic_time() - start) * 1e-6
+      allocs = allocations() - allocs
+      if elapsed >= options.time then
+	 return elapsed * 1e9 / iterations, allocs / iterations, iterations
+      end
+
+      -- Estimate the count needed, but grow at most 10 times per step.
+      local needed = elapsed > 0 and options.time / elapsed * iterations * 1.2
+	 or iterations * 10
+      iterations = math.floor(math.min(math.max(needed, iterations * 2),
+				       iterations * 10))
+   end
+end
+
+------------------------------------------------------------------------------
+-- Suites are arrays of { name, setup } pairs, where setup returns the function to be measured.  Entries may also contain 'elements', the number of elements marshalled by one call, and 'row' and 'column' placing the result into a matrix printed after the run.
+
+local suites = {}
+
+-- Returns setup of a benchmark measuring startup of a fresh interpreter, which loads LuaGObject and runs given code.
+local function startup(code)
+   return function()
+      local lua = arg and arg[-1] or 'lua'
+      local quote = function(s) return "'" .. s:gsub("'", "'\\''") .. "'" end
+      local command = quote(lua) .. ' -e ' .. quote(code)
+      return function()
+	 -- Lua 5.1 returns the exit status, later versions true on success.
+	 local status = os.execute(command)
+	 assert(status == true or status == 0, command)
+      end
+   end
+end
+
+suites.default = {
+   { 'scalar.int', function()
+	local test_int = LuaGObject.Regress.test_int
+	return function() test_int(42) end
+   end },
+   { 'scalar.double', function()
+	local test_double = LuaGObject.Regress.test_double
+	return function() test_double(4.2) end
+   end },
+   { 'scalar.boolean', function()
+	local test_boolean = LuaGObject.Regress.test_boolean
+	return function() test_boolean(true) end
+   end },
+   { 'scalar.method', function()
+	local obj = LuaGObject.Regress.TestObj()
+	return function() obj:instance_method() end
+   end },
+   { 'string.in', function()
+	local test_utf8_const_in = LuaGObject.Regress.test_utf8_const_in
+	return function() test_utf8_const_in('const ♥ utf8') end
+   end },
+   { 'string.return', function()
+	local test_utf8_nonconst_return =
+	   LuaGObject.Regress.test_utf8_nonconst_return
+	return function() test_utf8_nonconst_return() end
+   end },
+   { 'array.in', function()
+	local test_array_int_in = LuaGObject.Regress.test_array_int_in
+	local array = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 }
+	return function() test_array_int_in(array) end
+   end },
+   { 'array.out', function()
+	local test_array_int_out = LuaGObject.Regress.test_array_int_out
+	return function() test_array_int_out() end
+   end },
+   { 'list.in', function()
+	local test_glist_nothing_in = LuaGObject.Regress.test_glist_nothing_in
+	local list = { '1', '2', '3' }
+	return function() test_glist_nothing_in(list) end
+   end },
+   { 'list.return', function()
+	local test_glist_everything_return =
+	   LuaGObject.Regress.test_glist_everything_return
+	return function() test_glist_everything_return() end
+   end },
+   { 'hash.in', function()
+	local test_ghash_nothing_in = LuaGObject.Regress.test_ghash_nothing_in
+	local hash = { foo = 'bar', baz = 'bat', qux = 'quux' }
+	return function() test_ghash_nothing_in(hash) end
+   end },
+   { 'hash.return', function()
+	local test_ghash_container_return =
+	   LuaGObject.Regress.test_ghash_container_return
+	return function() test_ghash_container_return() end
+   end },
+   { 'record.new', function()
+	local TestStructA = LuaGObject.Regress.TestStructA
+	return function() TestStructA() end
+   end },
+   { 'record.field', function()
+	local struct = LuaGObject.Regress.TestStructA()
+	return function() struct.some_int = struct.some_int + 1 end
+   end },
+   { 'object.new', function()
+	local TestObj = LuaGObject.Regress.TestObj
+	return function() TestObj() end
+   end },
+   { 'object.return', function()
+	local obj = LuaGObject.Regress.TestObj()
+	obj.bare = LuaGObject.Regress.TestObj()
+	return function() local _ = obj.bare end
+   end },
+   { 'property.set', function()
+	local obj = LuaGObject.Regress.TestObj()
+	return function() obj.int = 42 end
+   end },
+   { 'property.get', function()
+	local obj = LuaGObject.Regress.TestObj()
+	return function() local _ = obj.int end
+   end },
+   { 'signal.connect', function()
+	local obj = LuaGObject.Regress.TestObj()
+	local GObject = LuaGObject.GObject
+	local handler = function() end
+	return function()
+	   GObject.signal_handler_disconnect(obj, obj.on_test:connect(handler))
+	end
+   end },
+   { 'signal.emit', function()
+	local obj = LuaGObject.Regress.TestObj()
+	obj.on_test:connect(function() end)
+	local signal = obj.on_test
+	return function() signal:emit() end
+   end },
+   { 'closure.callback', function()
+	local test_callback = LuaGObject.Regress.test_callback
+	local callback = function() return 42 end
+	return function() test_callback(callback) end
+   end },
+   { 'closure.gclosure', function()
+	local closure = LuaGObject.GObject.Closure(function() return 42 end)
+	local test_closure = LuaGObject.Regress.test_closure
+	return function() test_closure(closure, 42) end
+   end },
+   { 'variant.new', function()
+	local Variant = GLib.Variant
+	return function() Variant('(is)', { 42, 'text' }) end
+   end },
+   { 'variant.value', function()
+	local variant = GLib.Variant('(is)', { 42, 'text' })
+	return function() local _ = variant.value end
+   end },
+   { 'gi.info', function()
+	local info = require('LuaGObject.core').gi.Regress.TestObj
+	return function() local _ = info.methods[1].args[1].typeinfo.tag end
+   end },
+   { 'startup', startup("local _ = require('LuaGObject').Regress.TestObj") },
+   -- Gtk override loads its parts on demand, touching one class should not pay for the others; cairo override is loaded as a whole and serves as a reference.  Gtk is skipped when it cannot be initialized, e.g. without a display.
+   { 'startup.cairo', startup("local _ = require('LuaGObject').cairo.Context") },
+   { 'startup.gtk', startup("local _ = require('LuaGObject').Gtk.Window") },
+}
+
+-- Marshalling cost of each type tag, direction and transfer, using Regress test functions.  Results are reported in ns per marshalled element.
+suites.marshal = {}
+do
+   local ints = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 }
+   local strings = { '1', '2', '3' }
+   local hash = { foo = 'bar', baz = 'bat', qux = 'quux' }
+   for _, spec in ipairs {
+      -- tag, direction, transfer, elements, function, arguments
+      { 'boolean', 'in', 'none', 1, 'test_boolean', true },
+      { 'int8', 'in', 'none', 1, 'test_int8', 8 },
+      { 'uint8', 'in', 'none', 1, 'test_uint8', 8 },
+      { 'int16', 'in', 'none', 1, 'test_int16', 16 },
+      { 'uint16', 'in', 'none', 1, 'test_uint16', 16 },
+      { 'int32', 'in', 'none', 1, 'test_int32', 32 },
+      { 'uint32', 'in', 'none', 1, 'test_uint32', 32 },
+      { 'int64', 'in', 'none', 1, 'test_int64', 64 },
+      { 'uint64', 'in', 'none', 1, 'test_uint64', 64 },
+      { 'float', 'in', 'none', 1, 'test_float', 1.5 },
+      { 'double', 'in', 'none', 1, 'test_double', 1.5 },
+      { 'unichar', 'in', 'none', 1, 'test_unichar', 'c' },
+      { 'gtype', 'in', 'none', 1, 'test_gtype', 'GObject' },
+      { 'utf8', 'in', 'none', 1, 'test_utf8_const_in', 'const ♥ utf8' },
+      { 'utf8', 'return', 'none', 1, 'test_utf8_const_return' },
+      { 'utf8', 'return', 'full', 1, 'test_utf8_nonconst_return' },
+      { 'utf8', 'out', 'full', 1, 'test_utf8_out' },
+      { 'utf8', 'inout', 'full', 1, 'test_utf8_inout', 'const ♥ utf8' },
+      { 'filename', 'return', 'full', 1, 'test_filename_return' },
+      { 'array', 'in', 'none', #ints, 'test_array_int_in', ints },
+      { 'array.int8', 'in', 'none', #ints, 'test_array_int8_in', ints },
+      { 'array.int16', 'in', 'none', #ints, 'test_array_int16_in', ints },
+      { 'array.int32', 'in', 'none', #ints, 'test_array_int32_in', ints },
+      { 'array.int64', 'in', 'none', #ints, 'test_array_int64_in', ints },
+      { 'array', 'out', 'full', 5, 'test_array_int_out' },
+      { 'array', 'inout', 'full', 5, 'test_array_int_inout',
+	{ 1, 2, 3, 4, 5 } },
+      { 'array', 'return', 'none', 5, 'test_array_int_none_out' },
+      { 'array', 'return', 'full', 5, 'test_array_int_full_out' },
+      { 'array.fixed', 'return', 'full', 5,
+	'test_array_fixed_size_int_return' },
+      { 'array.utf8', 'in', 'none', 3, 'test_strv_in', strings },
+      { 'array.utf8', 'return', 'full', 5, 'test_strv_out' },
+      { 'array.utf8', 'return', 'container', 3, 'test_strv_out_container' },
+      { 'glist', 'in', 'none', 3, 'test_glist_nothing_in', strings },
+      { 'glist', 'return', 'none', 3, 'test_glist_nothing_return' },
+      { 'glist', 'return', 'container', 3, 'test_glist_container_return' },
+      { 'glist', 'return', 'full', 3, 'test_glist_everything_return' },
+      { 'gslist', 'in', 'none', 3, 'test_gslist_nothing_in', strings },
+      { 'gslist', 'return', 'none', 3, 'test_gslist_nothing_return' },
+      { 'gslist', 'return', 'container', 3, 'test_gslist_container_return' },
+      { 'gslist', 'return', 'full', 3, 'test_gslist_everything_return' },
+      { 'ghash', 'in', 'none', 3, 'test_ghash_nothing_in', hash },
+      { 'ghash', 'return', 'none', 3, 'test_ghash_nothing_return' },
+      { 'ghash', 'return', 'container', 3, 'test_ghash_container_return' },
+      { 'ghash', 'return', 'full', 3, 'test_ghash_everything_return' },
+      { 'interface', 'return', 'none', 1,
+	'test_simple_boxed_a_const_return' },
+   } do
+      local tag, direction, transfer, elements, name = unpack(spec, 1, 5)
+      local args = { n = #spec - 5, unpack(spec, 6) }
+      suites.marshal[#suites.marshal + 1] = {
+	 ('%s.%s.%s'):format(tag, direction, transfer),
+	 function()
+	    local func = LuaGObject.Regress[name]
+	    return function() func(unpack(args, 1, args.n)) end
+	 end,
+	 elements = elements, row = tag,
+	 column = direction .. '/' .. transfer,
+      }
+   end
+end
+
+------------------------------------------------------------------------------
+-- Runner.
+
+local function selected(name)
+   if #options.patterns == 0 then return true end
+   for _, pattern in ipairs(options.patterns) do
+      if name:match(pattern) then return true end
+   end
+   return false
+end
+
+local suite = suites[options.suite]
+   or error(("unknown suite '%s'"):format(options.suite))
+local results, rows, columns = {}, {}, {}
+for _, bench in ipairs(suite) do
+   local name, setup = bench[1], bench[2]
+   if selected(name) then
+      -- Functions missing in the Regress build at hand are skipped.
+      local ok, func = pcall(setup)
+      if ok then ok = pcall(func) end
+      if not ok then
+	 io.write(('%-20s skipped: %s\n'):format(name, tostring(func)))
+      else
+	 local ns, allocs, iterations = measure(func)
+	 local result = { ns_per_op = ns, allocs_per_op = allocs,
+			  iterations = iterations }
+	 results[name] = result
+	 io.write(('%-20s %12.1f ns/op %8.2f allocs/op'):format(
+		     name, ns, allocs))
+	 if bench.elements then
+	    result.ns_per_element = ns / bench.elements
+	    io.write(('%12.1f ns/element'):format(result.ns_per_element))
+	 end
+	 io.write('\n')
+	 io.flush()
+
+	 if bench.row then
+	    if not rows[bench.row] then
+	       rows[#rows + 1] = bench.row
+	       rows[bench.row] = {}
+	    end
+	    if not columns[bench.column] then
+	       columns[#columns + 1] = bench.column
+	       columns[bench.column] = true
+	    end
+	    rows[bench.row][bench.column] = result.ns_per_element or ns
+	 end
+      end
+   end
+end
+
+-- Print collected matrix, if the suite defines one.
+if #rows > 0 then
+   io.write(('\n%-12s'):format(''))
+   for _, column in ipairs(columns) do
+      io.write(('%15s'):format(column))
+   end
+   io.write('\n')
+   for _, row in ipairs(rows) do
+      io.write(('%-12s'):format(row))
+      for _, column in ipairs(columns) do
+	 local value = rows[row][column]
+	 io.write(value and ('%15.1f'):format(value) or ('%15s'):format('-'))
+      end
+      io.write('\n')
+   end
+end
+
+if options.output then
+   local file = assert(io.open(options.output, 'w'))
+   file:write(json.encode {
+		 lua = _VERSION, version = LuaGObject._VERSION,
+		 suite = options.suite, results = results }, '\n')
+   file:close()
+end
+
+if options.baseline then
+   local file = assert(io.open(options.baseline))
+   local baseline = json.decode(file:read('*a')).results
+   file:close()
+   local limit, regressions = 1 + options.threshold / 100, 0
+   io.write(('\nComparison against %s:\n'):format(options.baseline))
+   for _, bench in ipairs(suite) do
+      local name = bench[1]
+      local new, old = results[name], baseline[name]
+      if new and old and old.ns_per_op > 0 then
+	 local ratio = new.ns_per_op / old.ns_per_op
+	 local regressed = ratio > limit
+	 if regressed then regressions = regressions + 1 end
+	 io.write(('%-20s %+7.1f%% %+8.2f allocs/op%s\n'):format(
+		     name, (ratio - 1) * 100,
+		     new.allocs_per_op - old.allocs_per_op,
+		     regressed and '  REGRESSION' or ''))
+      end
+   end
+   if regressions > 0 then
+      io.write(('%d benchmark(s) slower by more than %g%%\n'):format(
+		  regressions, options.threshold))
+      os.exit(1)
+   end
+end
@@ -70,3 +70,182 @@ function gio.async_access()
 	end)(b)
 	check(Gio.DBusProxy:is_type_of(proxy))
 end
+
+function gio.async_pipe()
+	local Gio = LuaGObject.Gio
+	local data = ('0123456789abcdef'):rep(4096)
+
+	-- Compress data through the pipe, using small chunks so that the
+	-- ring has to wrap around several times.
+	local zipped = Gio.MemoryOutputStream.new_resizable()
+	local stats = Gio.Async.call(function()
+		return Gio.Async.pipe(
+			Gio.MemoryInputStream.new_from_data(data), zipped, {
+				converters = Gio.ZlibCompressor.new('GZIP', -1),
+				chunk = 1000, buffers = 3, close = true })
+	end)()
+	check(stats ~= nil)
+	checkv(stats.read, #data, 'number')
+	checkv(stats.written, #data, 'number')
+	check(zipped:get_data_size() < #data)
+
+	-- Decompress it back and compare with original.
+	local unzipped = Gio.MemoryOutputStream.new_resizable()
+	stats = Gio.Async.call(function()
+		return Gio.Async.pipe(
+			Gio.MemoryInputStream.new_from_bytes(zipped:steal_as_bytes()),
+			unzipped, {
+				converters = { Gio.ZlibDecompressor.new('GZIP') },
+				close = true })
+	end)()
+	check(stats ~= nil)
+	checkv(unzipped:steal_as_bytes().data, data, 'string')
+end
+
+function gio.async_combinators()
+	local GLib, Gio = LuaGObject.GLib, LuaGObject.Gio
+
+	-- Suspends calling coroutine for given time, then returns rest
+	-- of the arguments.
+	local function sleep(ms, ...)
+		local coro = coroutine.running()
+		GLib.timeout_add(GLib.PRIORITY_DEFAULT, ms, function()
+			coroutine.resume(coro)
+			return false
+		end)
+		coroutine.yield()
+		return ...
+	end
+
+	local all, any, race, timed, failed = Gio.Async.call(function()
+		return Gio.Async.all {
+			function() return sleep(20, 'a') end,
+			function() return sleep(10, 'b', 2) end,
+		}, Gio.Async.any {
+			function() return nil, 'fail' end,
+			function() return sleep(10, 'ok') end,
+		}, Gio.Async.race {
+			function() return sleep(50, 'slow') end,
+			function() return sleep(5, 'fast') end,
+		}, { Gio.Async.with_timeout(5, sleep, 50, 'late') },
+		{ Gio.Async.all {
+			function() return sleep(10, 'a') end,
+			function() return nil, 'fail' end,
+		} }
+	end)()
+	checkv(all[1][1], 'a', 'string')
+	checkv(all[2].n, 2, 'number')
+	checkv(all[2][1], 'b', 'string')
+	checkv(all[2][2], 2, 'number')
+	checkv(any, 'ok', 'string')
+	checkv(race, 'fast', 'string')
+	checkv(timed[1], nil, 'nil')
+	check(timed[2]:matches(Gio.IOErrorEnum, 'TIMED_OUT'))
+	checkv(failed[1], nil, 'nil')
+	checkv(failed[2], 'fail', 'string')
+
+	-- Combinators cannot be used outside of async context.
+	check(not pcall(Gio.Async.all, {}))
+end
+
+function gio.async_reuse()
+	local Gio = LuaGObject.Gio
+
+	-- Many operations started by the same coroutine share its ready
+	-- callback.
+	local input = Gio.MemoryInputStream.new_from_data(('x'):rep(1000))
+	local total = Gio.Async.call(function()
+		local total = 0
+		for _ = 1, 100 do
+			local bytes = input:async_read_bytes(10)
+			total = total + bytes:get_size()
+		end
+		input:async_close()
+		return total
+	end)()
+	checkv(total, 1000, 'number')
+end
+
+function gio.async_call_nested()
+	local GLib, Gio = LuaGObject.GLib, LuaGObject.Gio
+
+	-- Synchronously finishing function does not need any iteration.
+	checkv(Gio.Async.call(function(a, b) return a + b end)(1, 2),
+	       3, 'number')
+
+	-- Nested call from within the callback dispatched while the outer
+	-- one is waiting.
+	local inner
+	local outer = Gio.Async.call(function()
+		local coro = coroutine.running()
+		GLib.idle_add(GLib.PRIORITY_DEFAULT, function()
+			inner = Gio.Async.call(function()
+				local file = Gio.File.new_for_path('.')
+				return file:async_query_info('standard::type', 'NONE')
+			end)()
+			coroutine.resume(coro, 'outer')
+			return false
+		end)
+		return coroutine.yield()
+	end)()
+	checkv(outer, 'outer', 'string')
+	check(Gio.FileInfo:is_type_of(inner))
+
+	-- Errors are propagated to the caller.
+	check(not pcall(Gio.Async.call(function() error('fail') end)))
+
+	-- Including those raised after the coroutine was suspended.
+	local ok, err = pcall(Gio.Async.call(function()
+		local file = Gio.File.new_for_path('.')
+		file:async_query_info('standard::type', 'NONE')
+		error('late failure')
+	end))
+	check(not ok and err:match('late failure'))
+end
+
+function gio.deferred_callback()
+	local GLib, Gio = LuaGObject.GLib, LuaGObject.Gio
+
+	-- Invocation from the owner thread is delivered synchronously.
+	local loop = GLib.MainLoop()
+	local info
+	local file = Gio.File.new_for_path('.')
+	file:query_info_async('standard::type', 'NONE', GLib.PRIORITY_DEFAULT,
+		nil, LuaGObject.deferred(function(source, result)
+			info = source:query_info_finish(result)
+			loop:quit()
+		end))
+	loop:run()
+	check(Gio.FileInfo:is_type_of(info))
+
+	-- Wrapper can be called directly.
+	local wrapped = LuaGObject.deferred(function(a, b) return a + b end)
+	checkv(wrapped(1, 2), 3, 'number')
+end
+
+function gio.deferred_foreign_thread()
+	local GLib, R = LuaGObject.GLib, LuaGObject.Regress
+
+	-- Invocation from another thread is only queued, and delivered later from the main loop of the owner.
+	local loop = GLib.MainLoop()
+	local delivered, depth
+	local callback = LuaGObject.deferred(function()
+		delivered = true
+		depth = GLib.main_depth()
+		loop:quit()
+	end)
+	local queued
+	GLib.Thread.new('deferred', function()
+		R.test_simple_callback(callback)
+		queued = not delivered
+	end):join()
+	check(queued)
+	check(not delivered)
+
+	local timeout = GLib.timeout_add(GLib.PRIORITY_DEFAULT, 5000,
+		function() loop:quit() end)
+	loop:run()
+	GLib.source_remove(timeout)
+	check(delivered)
+	check(depth > 0)
+end
@@ -1478,3 +1478,38 @@ function gireg.callback_async()
 	collectgarbage()
 	check(R.test_callback_thaw_async() == 1)
 end
+
+function gireg.gi_names()
+	local core = require 'LuaGObject.core'
+	local methods = core.gi.Regress.TestObj.methods
+	local names = core.gi.names(methods)
+	check(methods[names.instance_method].name == 'instance_method')
+	local count = 0
+	for name, index in pairs(names) do
+		check(methods[index].name == name)
+		count = count + 1
+	end
+	check(count == #methods)
+	local R = LuaGObject.Regress
+	check(R.TestObj._method.instance_method)
+	check(R.TestObj._method.no_such_method == nil)
+end
+
+function gireg.gi_info_interned()
+	local core = require 'LuaGObject.core'
+	local info = core.gi.Regress.TestObj
+	check(info.type == 'object')
+	check(info.no_such_property == nil)
+
+	-- Parts of the info are wrapped only once.
+	check(rawequal(info.methods, info.methods))
+	local method = info.methods[1]
+	check(rawequal(method, info.methods[1]))
+	check(rawequal(method.args, method.args))
+	check(method.name == info.methods[method.name].name)
+
+	-- Wrappers of the same GIBaseInfo are shared.
+	local container = method.container
+	check(container == info)
+	check(rawequal(container, method.container))
+end
@@ -154,3 +154,314 @@ function glib.coroutine_related_crash()
     end)()
     mainloop:run()
 end
+
+function glib.timerwheel()
+   local GLib = LuaGObject.GLib
+   local wheel = GLib.TimerWheel(1)
+   local fired = {}
+   local loop = GLib.MainLoop()
+
+   -- Many one-shot timers, some of them removed before expiring.
+   local ids = {}
+   for i = 1, 1000 do
+      ids[i] = wheel:add(i % 20, function(id)
+	 fired[id] = true
+      end)
+   end
+   for i = 1, 1000, 10 do check(wheel:remove(ids[i])) end
+   check(not wheel:remove(ids[1]))
+   check(#wheel == 900)
+
+   -- Periodic timer which terminates the test after few rounds.
+   local rounds = 0
+   wheel:add(30, function()
+      rounds = rounds + 1
+      if rounds < 3 then return true end
+      loop:quit()
+   end)
+   loop:run()
+
+   check(rounds == 3)
+   check(#wheel == 0)
+   for i = 1, 1000 do check(fired[ids[i]] == (i % 10 ~= 1)) end
+   wheel:destroy()
+end
+
+function glib.worker()
+   local GLib, GObject = LuaGObject.GLib, LuaGObject.GObject
+   local pool = LuaGObject.worker.new([[
+      local LuaGObject = require 'LuaGObject'
+      local GLib = LuaGObject.GLib
+      return function(op, a, b)
+	 if op == 'add' then return a + b, { sum = a + b, args = { a, b } } end
+	 if op == 'variant' then return GLib.Variant('s', a:get_string() .. b) end
+	 if op == 'object' then return a end
+	 error('unknown op ' .. op)
+      end
+   ]], 2)
+   local loop = GLib.MainLoop()
+   local results, pending = {}, 0
+   local function send(key, ...)
+      pending = pending + 1
+      pool:send(function(...)
+	 results[key] = { ... }
+	 pending = pending - 1
+	 if pending == 0 then loop:quit() end
+      end, ...)
+   end
+
+   for i = 1, 10 do send(i, 'add', i, 100) end
+   send('variant', 'variant', GLib.Variant('s', 'abc'), 'def')
+   local obj = GObject.Object()
+   send('object', 'object', obj)
+   send('error', 'unknown')
+   check(#pool == 13)
+   loop:run()
+
+   for i = 1, 10 do
+      local res = results[i]
+      check(res[1] == true and res[2] == i + 100)
+      check(res[3].sum == i + 100 and res[3].args[2] == 100)
+   end
+   check(results.variant[1] and results.variant[2].value == 'abcdef')
+   check(results.object[1] and results.object[2] == obj)
+   check(results.error[1] == false)
+   check(results.error[2]:match('unknown op unknown'))
+
+   -- Values which cannot cross states are rejected by the sender.
+   check(not pcall(pool.send, pool, nil, function() end))
+   local cyclic = {}
+   cyclic.self = cyclic
+   check(not pcall(pool.send, pool, nil, cyclic))
+
+   -- Closing waits for and delivers outstanding jobs.
+   local closed
+   pool:send(function(ok, sum) closed = sum end, 'add', 1, 2)
+   pool:close()
+   check(closed == 3)
+   check(not pcall(pool.send, pool, nil, 'add', 1, 2))
+
+   -- Pool can be closed from its own callback; remaining results are still delivered.
+   pool = LuaGObject.worker.new('return function(a) return a end', 1)
+   local delivered = {}
+   for i = 1, 3 do
+      pool:send(function(ok, val)
+	 delivered[#delivered + 1] = val
+	 if val == 1 then pool:close() end
+	 if #delivered == 3 then loop:quit() end
+      end, i)
+   end
+   loop:run()
+   check(#delivered == 3)
+   check(not pcall(pool.send, pool, nil, 1))
+end
+
+function glib.parallel_map()
+   local GLib = LuaGObject.GLib
+   local core = require 'LuaGObject.core'
+   local checksum = GLib.compute_checksum_for_string
+
+   -- Callables have to be explicitly marked as thread-safe.
+   check(not pcall(core.callable.parallel_map, checksum, {}))
+   checksum.thread_safe = true
+   check(checksum.thread_safe)
+
+   local inputs = {}
+   for i = 1, 100 do
+      inputs[i] = { 'SHA256', ('input %d '):format(i):rep(i), -1 }
+   end
+   local results = core.callable.parallel_map(checksum, inputs, { threads = 4 })
+   check(#results == 100)
+   for i = 1, 100 do
+      check(results[i].n == 1)
+      check(results[i][1] == checksum('SHA256', inputs[i][2], -1))
+   end
+   check(#core.callable.parallel_map(checksum, {}) == 0)
+
+   -- Invalid thread count is reported with the name of the field.
+   local ok, err = pcall(core.callable.parallel_map, checksum, {},
+			 { threads = 'many' })
+   check(not ok and err:match("'threads'"))
+   check(not pcall(core.callable.parallel_map, checksum, {}, { threads = 0 }))
+   checksum.thread_safe = false
+end
+
+function glib.nolock()
+   local GLib = LuaGObject.GLib
+   local core = require 'LuaGObject.core'
+
+   -- Per-callable flag.
+   local monotonic = GLib.get_monotonic_time
+   check(not monotonic.nolock)
+   monotonic.nolock = true
+   check(monotonic() > 0)
+   monotonic.nolock = false
+
+   -- Typetable annotation.
+   GLib.Date._nolock = { get_day = true }
+   check(GLib.Date.get_day.nolock)
+   check(not GLib.Date.get_month.nolock)
+   check(GLib.Date.new_dmy(17, 'MARCH', 2025):get_day() == 17)
+
+   -- Global single-threaded mode.
+   check(core.callable.single_threaded(true) == false)
+   check(GLib.get_real_time() > 0)
+   check(core.callable.single_threaded(false) == true)
+end
+
+function glib.lock_stats()
+   local GLib = LuaGObject.GLib
+   local core = require 'LuaGObject.core'
+
+   -- Calls which release the lock do not hold it, nolock calls do.
+   local real_time, monotonic = GLib.get_real_time, GLib.get_monotonic_time
+   local nolock = monotonic.nolock
+   monotonic.nolock = true
+   core.stats_reset(true)
+   for _ = 1, 10 do real_time() end
+   for _ = 1, 10 do monotonic() end
+   local lock = core.stats().lock
+   check(lock.acquisitions >= 10)
+   check(lock.hold.histogram[1].count > 0)
+   local found = {}
+   for _, holder in ipairs(lock.holders) do
+      found[holder.name:match('get_%w+_time') or holder.name] = holder
+   end
+   check(not found.get_real_time)
+   check(found.get_monotonic_time and found.get_monotonic_time.count == 10
+	 and found.get_monotonic_time.kind == 'callable')
+   monotonic.nolock = nolock
+
+   core.stats_reset(false)
+   check(core.stats().lock == nil)
+end
+
+function glib.alloc_stats()
+   local GLib = LuaGObject.GLib
+   local core = require 'LuaGObject.core'
+
+   collectgarbage()
+   local before = core.stats().alloc.record_embedded
+   local records = {}
+   for i = 1, 10 do records[i] = core.record.new(GLib.Date) end
+   local during = core.stats().alloc.record_embedded
+   check(during.allocs - before.allocs >= 10)
+   check(during.live - before.live >= 10)
+   check(during.bytes > before.bytes)
+   records = nil
+   collectgarbage()
+   collectgarbage()
+   check(core.stats().alloc.record_embedded.live <= before.live)
+   for _, category in ipairs { 'callable', 'closure', 'guard', 'record',
+			       'object', 'gi_info', 'array' } do
+      check(core.stats().alloc[category].live >= 0)
+   end
+end
+
+function glib.census()
+   local GLib = LuaGObject.GLib
+   local GObject = LuaGObject.GObject
+   local core = require 'LuaGObject.core'
+
+   collectgarbage()
+   local before = core.census()
+   local keep = { GObject.Object(), GObject.Object(), core.record.new(GLib.Date) }
+   local diff = core.census(before)
+   check(diff.objects.GObject.count == 2)
+   check(diff.objects.GObject.size > 0)
+   check(diff.records['GLib.Date'].count == 1)
+   check(diff.refs == 2)
+   keep = nil
+   collectgarbage()
+   collectgarbage()
+   check(core.census(before).objects.GObject == nil)
+end
+
+function glib.profile()
+   local GLib = LuaGObject.GLib
+   local core = require 'LuaGObject.core'
+
+   core.profile.start()
+   for _ = 1, 10 do GLib.get_real_time() end
+   local loop = GLib.MainLoop()
+   GLib.idle_add(GLib.PRIORITY_DEFAULT, function() loop:quit() end)
+   loop:run()
+   core.profile.stop()
+   GLib.get_real_time()
+
+   local callable, closure
+   for _, entry in ipairs(core.profile.report()) do
+      if entry.name:match('get_real_time') then callable = entry end
+      if entry.kind == 'closure' then closure = entry end
+      check(entry.total == entry.marshal + entry.call + entry.unmarshal)
+   end
+   check(callable and callable.kind == 'callable' and callable.calls == 10)
+   check(closure and closure.calls == 1)
+
+   -- Restarting discards collected data.
+   core.profile.start()
+   core.profile.stop()
+   check(#core.profile.report() == 0)
+end
+
+function glib.profile_sample()
+   local GLib = LuaGObject.GLib
+   local core = require 'LuaGObject.core'
+
+   local function crossing() return GLib.get_real_time() end
+   core.profile.start { sample = 2 }
+   for _ = 1, 10 do crossing() end
+   core.profile.stop()
+
+   local count, found = 0
+   for stack, weight in core.profile.folded():gmatch('([^\n]+) (%d+)\n') do
+      count = count + tonumber(weight)
+      if stack:match('crossing@.*;GLib%.get_real_time$') then found = true end
+   end
+   check(count == 5)
+   check(found)
+   check(core.profile.folded('time'):match(' %d+\n$'))
+end
+
+function glib.perfmap()
+   local GLib = LuaGObject.GLib
+   local core = require 'LuaGObject.core'
+
+   -- The map is named after pid, which is readily available only on Linux.
+   local stat = io.open('/proc/self/stat')
+   if not stat then return end
+   local pid = stat:read('*l'):match('^(%d+)')
+   stat:close()
+
+   local previous = core.perfmap(true)
+   local loop = GLib.MainLoop()
+   GLib.idle_add(GLib.PRIORITY_DEFAULT, function() loop:quit() end)
+   loop:run()
+   core.perfmap(previous)
+
+   local map = io.open('/tmp/perf-' .. pid .. '.map')
+   check(map)
+   local found
+   for line in map:lines() do
+      if line:match('^%x+ %x+ GLib%.SourceFunc callback$') then found = true end
+   end
+   map:close()
+   check(found)
+   if not previous then os.remove('/tmp/perf-' .. pid .. '.map') end
+end
+
+function glib.eager_resolve()
+   local GLib = LuaGObject.GLib
+   local core = require 'LuaGObject.core'
+
+   local previous = core.callable.eager(true)
+   check(core.callable.eager() == true)
+
+   -- Functions looked up while the resolver runs work whether or not it got to them before the call.
+   local strup, basename = GLib.ascii_strup, GLib.path_get_basename
+   check(strup('abc', -1) == 'ABC')
+   check(basename('/a/b') == 'b')
+
+   check(core.callable.eager(previous) == true)
+   check(GLib.ascii_strdown('ABC', -1) == 'abc')
+end
@@ -35,6 +35,16 @@ const char add_async[] =
 "end)(stream)"
 ;
 
+/* Queues call of deferred callback from another thread, which stays pending when the state is closed. */
+const char add_deferred[] =
+"local LuaGObject = require('LuaGObject');"
+"local GLib = LuaGObject.GLib;"
+"local callback = LuaGObject.deferred(function() delivered = true end);"
+"GLib.Thread.new('deferred', function()"
+"  LuaGObject.Regress.test_simple_callback(callback);"
+"end):join()"
+;
+
 int main()
 {
   /* Set up multiple Lua states */
@@ -67,6 +77,15 @@ int main()
 
   lua_close (L1);
   lua_close (L2);
+
+  /* Closing the state with a deferred call still pending must drop the call instead of delivering it into the closed state later. */
+  L1 = luaL_newstate ();
+  luaL_openlibs (L1);
+  run_string (L1, add_deferred);
+  lua_close (L1);
+  run_string (L3, "local context = require('LuaGObject').GLib.MainContext.default();"
+                  "for _ = 1, 10 do context:iteration(false) end");
+
   lua_close (L3);
 
   puts ("Success");
@@ -0,0 +1,69 @@
+#! /usr/bin/env lua
+------------------------------------------------------------------------------
+--
+--  Precompiles LuaGObject Lua modules and emits them as C source, which is
+--  linked into lua_gobject_core and registered in package.preload.
+--
+--  Usage: lua embed-lua.lua output.c LuaGObject/init.lua ...
+--
+--  Module names are derived from file paths, starting with the last
+--  'LuaGObject' directory component, e.g. LuaGObject/override/Gtk.lua
+--  becomes 'LuaGObject.override.Gtk'.  The bytecode is produced by the
+--  interpreter running this script, so it must be the same Lua (or LuaJIT)
+--  version the core is built against.
+--
+--  Licensed under the MIT license:
+--  http://www.opensource.org/licenses/mit-license.php
+--
+------------------------------------------------------------------------------
+
+local load = rawget(_G, 'loadstring') or load
+
+local output = assert(arg[1], 'usage: embed-lua.lua output.c file.lua ...')
+
+-- Converts file path to the module name.
+local function module_name(path)
+	path = path:gsub('\\', '/')
+	local start
+	for pos in path:gmatch('()LuaGObject/') do start = pos end
+	local name = assert(start and path:sub(start):match('^(.*)%.lua$'),
+		"cannot derive module name of '" .. path .. "'")
+	return (name:gsub('/', '.')), name .. '.lua'
+end
+
+local out = {}
+out[#out + 1] = '/* Generated by tools/embed-lua.lua, do not edit. */\n\n'
+out[#out + 1] = '#include "lua_gobject.h"\n'
+
+local modules, seen = {}, {}
+for i = 2, #arg do
+	local name, source = module_name(arg[i])
+	if not seen[name] then
+		seen[name] = true
+		local file = assert(io.open(arg[i], 'rb'))
+		local chunk = assert(load(file:read('*a'), '@' .. source))
+		file:close()
+
+		-- Debug info is kept, so that errors and tracebacks still point to source lines.
+		local code = string.dump(chunk)
+		local lines = {}
+		for pos = 1, #code, 16 do
+			lines[#lines + 1] = table.concat({ code:byte(pos, pos + 15) }, ',')
+		end
+		modules[#modules + 1] = name
+		out[#out + 1] = string.format(
+			'\n/* %s */\nstatic const unsigned char module_%d[] = {\n\t%s\n};\n',
+			name, #modules, table.concat(lines, ',\n\t'))
+	end
+end
+
+out[#out + 1] = '\nconst LuaGObjectEmbedded lua_gobject_embedded[] = {\n'
+for i, name in ipairs(modules) do
+	out[#out + 1] = string.format(
+		'\t{ "%s", module_%d, sizeof(module_%d) },\n', name, i, i)
+end
+out[#out + 1] = '\t{ NULL, NULL, 0 }\n};\n'
+
+local file = assert(io.open(output, 'wb'))
+file:write(table.concat(out))
+file:close()